@@ -0,0 +1,200 @@
+/****************************************************************************/
+/*                                                                          */
+/* Filename:       CentreGridIndex.cpp                                      */
+/*                                                                          */
+/* File base:      CentreGridIndex                                          */
+/* File extension: cpp                                                      */
+/*                                                                          */
+/* Purpose:        uniform grid of buckets over the cluster centres, to     */
+/*                 find the centres near a point when they are no longer    */
+/*                 on a regular grid                                        */
+/*                                                                          */
+/****************************************************************************/
+
+#include "CentreGridIndex.h"
+
+#include <algorithm>
+#include <cfloat>
+
+/****************************************************************************/
+/*                         Centres Grid Index                               */
+/****************************************************************************/
+CentreGridIndex::CentreGridIndex()
+{
+	this->cellSize = 1;
+	this->cellsPerRow = 0;
+	this->cellsPerColumn = 0;
+}
+
+void CentreGridIndex::reset(
+	const int width,
+	const int height,
+	const int cellSize)
+{
+	this->cellSize = std::max(cellSize, 1);
+	this->cellsPerRow = std::max((width + this->cellSize - 1) / this->cellSize, 1);
+	this->cellsPerColumn = std::max((height + this->cellSize - 1) / this->cellSize, 1);
+
+	/* Keep the memory of the cells, the index is rebuilt often. */
+	cells.resize(cellsPerRow * cellsPerColumn);
+
+	for (size_t n = 0; n < cells.size(); ++n)
+		cells[n].clear();
+
+	cellOfCentre.clear();
+}
+
+void CentreGridIndex::build(
+	const std::vector<double>& centres,
+	const unsigned             centresNumber,
+	const int                  width,
+	const int                  height,
+	const int                  cellSize)
+{
+	reset(width, height, cellSize);
+
+	for (unsigned centreIndex = 0; centreIndex < centresNumber; ++centreIndex)
+		insert(centreIndex, centres[5 * centreIndex + 3], centres[5 * centreIndex + 4]);
+}
+
+void CentreGridIndex::insert(
+	const unsigned centreIndex,
+	const double   x,
+	const double   y)
+{
+	if (cells.empty())
+		return;
+
+	const int cell = getCell(x, y);
+
+	if (cellOfCentre.size() <= centreIndex)
+		cellOfCentre.resize(centreIndex + 1, -1);
+
+	cellOfCentre[centreIndex] = cell;
+	cells[cell].push_back(centreIndex);
+}
+
+void CentreGridIndex::update(
+	const unsigned centreIndex,
+	const double   x,
+	const double   y)
+{
+	if (centreIndex >= cellOfCentre.size() || cellOfCentre[centreIndex] == -1)
+	{
+		insert(centreIndex, x, y);
+		return;
+	}
+
+	const int cell = getCell(x, y);
+
+	if (cell == cellOfCentre[centreIndex])
+		return;
+
+	std::vector<unsigned>& oldCell = cells[cellOfCentre[centreIndex]];
+	oldCell.erase(std::find(oldCell.begin(), oldCell.end(), centreIndex));
+
+	cellOfCentre[centreIndex] = cell;
+	cells[cell].push_back(centreIndex);
+}
+
+int CentreGridIndex::getCellSize() const
+{
+	return cellSize;
+}
+
+int CentreGridIndex::getCellsPerRow() const
+{
+	return cellsPerRow;
+}
+
+int CentreGridIndex::getCellsPerColumn() const
+{
+	return cellsPerColumn;
+}
+
+int CentreGridIndex::getCell(
+	const double x,
+	const double y) const
+{
+	const int cellX = std::min(std::max(static_cast<int>(x) / cellSize, 0), cellsPerRow - 1);
+	const int cellY = std::min(std::max(static_cast<int>(y) / cellSize, 0), cellsPerColumn - 1);
+
+	return cellY * cellsPerRow + cellX;
+}
+
+const std::vector<unsigned>& CentreGridIndex::getCellCentres(
+	const int cellX,
+	const int cellY) const
+{
+	return cells[cellY * cellsPerRow + cellX];
+}
+
+void CentreGridIndex::findNearbyCentres(
+	const double           x,
+	const double           y,
+	std::vector<unsigned>& nearbyCentres) const
+{
+	const int cell = getCell(x, y);
+	const int cellX = cell % cellsPerRow;
+	const int cellY = cell / cellsPerRow;
+
+	for (int tempY = std::max(cellY - 1, 0); tempY <= std::min(cellY + 1, cellsPerColumn - 1); ++tempY)
+		for (int tempX = std::max(cellX - 1, 0); tempX <= std::min(cellX + 1, cellsPerRow - 1); ++tempX)
+		{
+			const std::vector<unsigned>& cellCentres = cells[tempY * cellsPerRow + tempX];
+			nearbyCentres.insert(nearbyCentres.end(), cellCentres.begin(), cellCentres.end());
+		}
+}
+
+int CentreGridIndex::findNearestCentre(
+	const double               x,
+	const double               y,
+	const std::vector<double>& centres) const
+{
+	const int cell = getCell(x, y);
+	const int cellX = cell % cellsPerRow;
+	const int cellY = cell / cellsPerRow;
+
+	int    nearestCentre = -1;
+	double nearestDistance = DBL_MAX;
+
+	for (int ring = 0; ring < std::max(cellsPerRow, cellsPerColumn); ++ring)
+	{
+		/* The query may lie anywhere in its cell, so the centres of this
+		ring and beyond are only (ring - 1) x cellSize away at least. */
+		const double ringDistance = static_cast<double>(std::max(ring - 1, 0)) * cellSize;
+
+		if (nearestCentre != -1 && nearestDistance <= ringDistance * ringDistance)
+			break;
+
+		for (int tempY = cellY - ring; tempY <= cellY + ring; ++tempY)
+			for (int tempX = cellX - ring; tempX <= cellX + ring; ++tempX)
+			{
+				/* Only the border of the ring is new. */
+				if (tempY != cellY - ring && tempY != cellY + ring &&
+					tempX != cellX - ring && tempX != cellX + ring)
+					continue;
+
+				if (tempX < 0 || tempX >= cellsPerRow || tempY < 0 || tempY >= cellsPerColumn)
+					continue;
+
+				const std::vector<unsigned>& cellCentres = cells[tempY * cellsPerRow + tempX];
+
+				for (size_t n = 0; n < cellCentres.size(); ++n)
+				{
+					const double differenceX = centres[5 * cellCentres[n] + 3] - x;
+					const double differenceY = centres[5 * cellCentres[n] + 4] - y;
+					const double distance = differenceX * differenceX + differenceY * differenceY;
+
+					if (distance < nearestDistance ||
+						(distance == nearestDistance && static_cast<int>(cellCentres[n]) < nearestCentre))
+					{
+						nearestDistance = distance;
+						nearestCentre = cellCentres[n];
+					}
+				}
+			}
+	}
+
+	return nearestCentre;
+}
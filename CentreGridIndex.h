@@ -0,0 +1,101 @@
+/****************************************************************************/
+/*                                                                          */
+/* Filename:       CentreGridIndex.h                                        */
+/*                                                                          */
+/* File base:      CentreGridIndex                                          */
+/* File extension: h                                                        */
+/*                                                                          */
+/* Purpose:        uniform grid of buckets over the cluster centres, to     */
+/*                 find the centres near a point when they are no longer    */
+/*                 on a regular grid                                        */
+/*                                                                          */
+/****************************************************************************/
+
+#ifndef CENTREGRIDINDEX_H
+#define CENTREGRIDINDEX_H
+
+#include <vector>
+
+/****************************************************************************/
+/*                         Centres Grid Index                               */
+/****************************************************************************/
+class CentreGridIndex
+{
+	private:
+
+		/* Side of the square cells, in pixels. */
+		int cellSize;
+
+		int cellsPerRow;
+		int cellsPerColumn;
+
+		/* Indexes of the centres lying in each cell, in insertion order. */
+		std::vector<std::vector<unsigned>> cells;
+
+		/* Cell of each indexed centre, -1 for centres not in the index. */
+		std::vector<int> cellOfCentre;
+
+	public:
+
+		CentreGridIndex();
+
+		/* Empty the index and cover a width x height image with cells
+		   of cellSize pixels. */
+		void reset(
+			const int width,
+			const int height,
+			const int cellSize);
+
+		/* Index all the centres stored as [L, A, B, x, y] in centres. */
+		void build(
+			const std::vector<double>& centres,
+			const unsigned             centresNumber,
+			const int                  width,
+			const int                  height,
+			const int                  cellSize);
+
+		/* Add a centre. Centres outside the image go to the nearest border
+		   cell, so they are still found from inside the image. */
+		void insert(
+			const unsigned centreIndex,
+			const double   x,
+			const double   y);
+
+		/* Move an indexed centre after its position has been updated. */
+		void update(
+			const unsigned centreIndex,
+			const double   x,
+			const double   y);
+
+		int getCellSize() const;
+
+		int getCellsPerRow() const;
+
+		int getCellsPerColumn() const;
+
+		/* Cell containing (x, y), clamped to the grid. */
+		int getCell(
+			const double x,
+			const double y) const;
+
+		/* Centres of a cell, given its position in the grid. */
+		const std::vector<unsigned>& getCellCentres(
+			const int cellX,
+			const int cellY) const;
+
+		/* Append to nearbyCentres the centres of the 3 x 3 cells around
+		   (x, y): every centre within cellSize of it is among them. */
+		void findNearbyCentres(
+			const double           x,
+			const double           y,
+			std::vector<unsigned>& nearbyCentres) const;
+
+		/* Nearest centre to (x, y) in space, looking at rings of cells of
+		   growing size; -1 when the index is empty. */
+		int findNearestCentre(
+			const double               x,
+			const double               y,
+			const std::vector<double>& centres) const;
+};
+
+#endif
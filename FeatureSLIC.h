@@ -0,0 +1,788 @@
+/****************************************************************************/
+/*                                                                          */
+/* Filename:       FeatureSLIC.h                                            */
+/*                                                                          */
+/* File base:      FeatureSLIC                                              */
+/* File extension: h                                                        */
+/*                                                                          */
+/* Purpose:        SLIC superpixels of still images specialized at compile  */
+/*                 time over the number of channels, the pixel type and the */
+/*                 distance type (grayscale/IR, Lab, Lab + depth), or over  */
+/*                 any number of weighted feature channels                  */
+/*                                                                          */
+/****************************************************************************/
+
+#ifndef FEATURESLIC_H
+#define FEATURESLIC_H
+
+/* OpenCV libraries. */
+#include <opencv2/opencv.hpp>
+
+/* Intel TBB libraries. */
+#include <tbb/tbb.h>
+
+/* Cells of the centres, to run far apart clusters at once. */
+#include "CentreGridIndex.h"
+
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+/* Channels argument of FeatureSLIC for images whose number of channels is
+   only known at run time. */
+const unsigned DYNAMIC_CHANNELS = 0;
+
+/****************************************************************************/
+/*                             Pixel traits                                 */
+/****************************************************************************/
+
+/* OpenCV depth of each supported pixel type and the full range of its
+   values: the spatial term is scaled by it, so that spatialDistanceWeight
+   means the same for 8-bit, 16-bit and float ([0, 1]) images. Images
+   with another range set it with FeatureSLIC::setValueRange. */
+template <typename PixelT>
+struct FeaturePixelTraits;
+
+template <>
+struct FeaturePixelTraits<uchar>
+{
+	static const int depth = CV_8U;
+	static double range() { return 255.0; }
+};
+
+template <>
+struct FeaturePixelTraits<ushort>
+{
+	static const int depth = CV_16U;
+	static double range() { return 65535.0; }
+};
+
+template <>
+struct FeaturePixelTraits<float>
+{
+	static const int depth = CV_32F;
+	static double range() { return 1.0; }
+};
+
+/****************************************************************************/
+/*                            Feature kernels                               */
+/****************************************************************************/
+
+/* Per-pixel operations over the first Channels values of a pixel, unrolled
+   by recursion on the channel count: each instantiation only touches the
+   channels it has. The channels argument is only used by the dynamic
+   kernels below. */
+template <unsigned Channels, typename PixelT, typename DistanceT>
+struct FeatureKernels
+{
+	/* Squared distance between the channels of a pixel and of a centre. */
+	static inline DistanceT colorDistance(
+		const PixelT*    pixel,
+		const DistanceT* centre,
+		const unsigned   channels)
+	{
+		const DistanceT difference = static_cast<DistanceT>(pixel[Channels - 1]) - centre[Channels - 1];
+
+		return FeatureKernels<Channels - 1, PixelT, DistanceT>::colorDistance(pixel, centre, channels) +
+			difference * difference;
+	}
+
+	/* Same as colorDistance, with each squared difference weighted. */
+	static inline DistanceT weightedColorDistance(
+		const PixelT*    pixel,
+		const DistanceT* centre,
+		const DistanceT* weights,
+		const unsigned   channels)
+	{
+		const DistanceT difference = static_cast<DistanceT>(pixel[Channels - 1]) - centre[Channels - 1];
+
+		return FeatureKernels<Channels - 1, PixelT, DistanceT>::weightedColorDistance(pixel, centre, weights, channels) +
+			weights[Channels - 1] * difference * difference;
+	}
+
+	/* Add the channels of a pixel to the sums of a centre. */
+	static inline void accumulate(
+		const PixelT*  pixel,
+		double*        sums,
+		const unsigned channels)
+	{
+		FeatureKernels<Channels - 1, PixelT, DistanceT>::accumulate(pixel, sums, channels);
+		sums[Channels - 1] += pixel[Channels - 1];
+	}
+
+	/* Copy the channels of a pixel into a centre. */
+	static inline void copy(
+		const PixelT*  pixel,
+		DistanceT*     centre,
+		const unsigned channels)
+	{
+		FeatureKernels<Channels - 1, PixelT, DistanceT>::copy(pixel, centre, channels);
+		centre[Channels - 1] = pixel[Channels - 1];
+	}
+};
+
+template <typename PixelT, typename DistanceT>
+struct FeatureKernels<0, PixelT, DistanceT>
+{
+	static inline DistanceT colorDistance(
+		const PixelT*,
+		const DistanceT*,
+		const unsigned)
+	{
+		return 0;
+	}
+
+	static inline DistanceT weightedColorDistance(
+		const PixelT*,
+		const DistanceT*,
+		const DistanceT*,
+		const unsigned)
+	{
+		return 0;
+	}
+
+	static inline void accumulate(
+		const PixelT*,
+		double*,
+		const unsigned)
+	{
+	}
+
+	static inline void copy(
+		const PixelT*,
+		DistanceT*,
+		const unsigned)
+	{
+	}
+};
+
+/* Same operations as FeatureKernels, looping over a number of channels
+   given at run time (DYNAMIC_CHANNELS). */
+template <typename PixelT, typename DistanceT>
+struct DynamicFeatureKernels
+{
+	static inline DistanceT colorDistance(
+		const PixelT*    pixel,
+		const DistanceT* centre,
+		const unsigned   channels)
+	{
+		DistanceT distance = 0;
+
+		for (unsigned channel = 0; channel < channels; ++channel)
+		{
+			const DistanceT difference = static_cast<DistanceT>(pixel[channel]) - centre[channel];
+			distance += difference * difference;
+		}
+
+		return distance;
+	}
+
+	static inline DistanceT weightedColorDistance(
+		const PixelT*    pixel,
+		const DistanceT* centre,
+		const DistanceT* weights,
+		const unsigned   channels)
+	{
+		DistanceT distance = 0;
+
+		for (unsigned channel = 0; channel < channels; ++channel)
+		{
+			const DistanceT difference = static_cast<DistanceT>(pixel[channel]) - centre[channel];
+			distance += weights[channel] * difference * difference;
+		}
+
+		return distance;
+	}
+
+	static inline void accumulate(
+		const PixelT*  pixel,
+		double*        sums,
+		const unsigned channels)
+	{
+		for (unsigned channel = 0; channel < channels; ++channel)
+			sums[channel] += pixel[channel];
+	}
+
+	static inline void copy(
+		const PixelT*  pixel,
+		DistanceT*     centre,
+		const unsigned channels)
+	{
+		for (unsigned channel = 0; channel < channels; ++channel)
+			centre[channel] = pixel[channel];
+	}
+};
+
+/****************************************************************************/
+/*                              Feature SLIC                                */
+/****************************************************************************/
+template <unsigned Channels, typename PixelT, typename DistanceT>
+class FeatureSLIC
+{
+public:
+
+	/* Unrolled kernels for a fixed number of channels, loops otherwise. */
+	typedef typename std::conditional<Channels == DYNAMIC_CHANNELS,
+		DynamicFeatureKernels<PixelT, DistanceT>,
+		FeatureKernels<Channels, PixelT, DistanceT>>::type Kernels;
+
+protected:
+
+	/* Number of pixels of the image. */
+	unsigned pixelsNumber;
+
+	/* Number of channels of the last image, for DYNAMIC_CHANNELS. */
+	unsigned channelsNumber;
+
+	/* Weight of the squared difference of each channel. When they are all
+	   1 the unweighted kernels are used. */
+	std::vector<DistanceT> channelWeights;
+	bool                   weightedChannels;
+
+	/* Step of the initial grid of centres. */
+	unsigned samplingStep;
+
+	/* Full range of the pixel values. */
+	double valueRange;
+
+	/* Weight of the spatial distance, scaled by the sampling step and by
+	   the range of the pixel values. */
+	DistanceT distanceFactor;
+
+	/* Channels and position of each centre (centreSize() values each). */
+	std::vector<DistanceT> clusterCentres;
+	std::vector<DistanceT> previousClusterCentres;
+
+	/* Sums of the channels and positions of the pixels of each cluster,
+	   in double precision whatever DistanceT is: float sums lose the
+	   unit of the positions beyond 2^24. */
+	std::vector<double> centreSums;
+
+	/* Number of pixels of each cluster. */
+	std::vector<unsigned> pixelsOfSameCluster;
+
+	/* Shift of each centre in the last iteration. */
+	std::vector<double> residualError;
+
+	/* Cluster of each pixel, and its distance from the cluster centre. */
+	std::vector<int>       pixelCluster;
+	std::vector<DistanceT> distanceFromClusterCentre;
+
+	/* Centres by cell, so that clusters which cannot share a pixel run
+	   at the same time. */
+	CentreGridIndex centresGrid;
+
+	/* Number of channels of the pixels: a constant unless the template is
+	   instantiated with DYNAMIC_CHANNELS. */
+	inline unsigned channels() const
+	{
+		return (Channels != DYNAMIC_CHANNELS) ? Channels : channelsNumber;
+	}
+
+	/* Values stored for each centre: the channels, then x and y. */
+	inline unsigned centreSize() const
+	{
+		return channels() + 2;
+	}
+
+	/* Initialize the centres on a regular grid. */
+	void initializeCentres(const cv::Mat& image);
+
+	/* Find the pixel with the lowest gradient of the first channel in a
+	   3x3 surrounding. */
+	cv::Point findLowestGradient(
+		const cv::Mat&   image,
+		const cv::Point& centre) const;
+
+	/* Assign the pixels in the search region of a cluster to the cluster,
+	   if the cluster is the nearest found so far. */
+	template <bool Weighted>
+	void assignClusterPixels(
+		const cv::Mat& image,
+		const unsigned centreIndex);
+
+	/* Assign the pixels to the clusters in nine parallel phases: the
+	   clusters of cells three cells apart never share a pixel. */
+	void assignPixels(const cv::Mat& image);
+
+	/* Recompute the centres from the pixels of their clusters. */
+	void updateCentres(const cv::Mat& image);
+
+	/* Compute the shift of a centre, as the distance between its old and
+	   new values in pixels, and remember its values. */
+	void updateResidualError(const unsigned centreIndex);
+
+public:
+
+	/* Total number of clusters. */
+	unsigned clustersNumber;
+
+	/* Number of iterations run on the last image. */
+	unsigned iterationIndex;
+
+	/* Average shift of the centres in the last iteration. */
+	double totalResidualError;
+
+	/* Class constructor. */
+	FeatureSLIC();
+
+	/* Set the weight of the squared difference of each channel, e.g. to
+	   balance a depth or optical flow channel against L, A, B. Channels
+	   without a weight have weight 1. */
+	void setChannelWeights(const std::vector<double>& weights);
+
+	/* Set the full range of the pixel values, which scales the spatial
+	   term (by default 255, 65535 or 1 as the pixel type). */
+	void setValueRange(const double range);
+
+	/* Interleave the channels of several images of type PixelT (e.g. a Lab
+	   frame, a depth map and a two-channel flow field) into one image.
+	   Return false if they differ in size or type. */
+	static bool stackFeatures(
+		const std::vector<cv::Mat>& features,
+		cv::Mat&                    image);
+
+	/* Generate superpixels for an image whose type is Channels values of
+	   type PixelT (any number of them for DYNAMIC_CHANNELS). Iterate
+	   iterationNumber times, or less if errorThreshold is not zero and the
+	   residual error falls below it. Return false if the image has another
+	   type. */
+	bool createSuperpixels(
+		const cv::Mat& image,
+		const unsigned samplingStep,
+		const unsigned spatialDistanceWeight,
+		const unsigned iterationNumber,
+		const double   errorThreshold = 0);
+
+	/* Cluster of each pixel, in row-major order (-1 if unassigned). */
+	const std::vector<int>& getPixelClusters() const;
+
+	/* Channels and position of each centre (channels + 2 values each). */
+	const std::vector<DistanceT>& getClusterCentres() const;
+};
+
+/* Grayscale and infrared cameras. */
+typedef FeatureSLIC<1, uchar, float>  GraySLIC;
+typedef FeatureSLIC<1, ushort, float> IRSLIC;
+
+/* Lab frames, as produced by cv::cvtColor. */
+typedef FeatureSLIC<3, uchar, float>  LabSLIC;
+
+/* Lab frames converted from float images by cv::cvtColor: L is in
+   [0, 100] and A, B in [-127, 127], the scale of the A, B values of
+   8-bit frames, so the spatial term is scaled as for them. */
+class LabFloatSLIC : public FeatureSLIC<3, float, float>
+{
+public:
+
+	LabFloatSLIC()
+	{
+		setValueRange(255.0);
+	}
+};
+
+/* 8-bit Lab frames (as from cv::cvtColor) widened to 16 bits to stack
+   them with an aligned 16-bit depth channel: L, A, B stay in [0, 255],
+   so the spatial term is scaled as for 8-bit frames, and the depth is
+   balanced against them with FeatureSLIC::setChannelWeights. */
+class LabDepthSLIC : public FeatureSLIC<4, ushort, float>
+{
+public:
+
+	LabDepthSLIC()
+	{
+		setValueRange(255.0);
+	}
+};
+
+/* Float Lab frames (as for LabFloatSLIC) with an aligned depth channel,
+   balanced against L, A, B with FeatureSLIC::setChannelWeights. */
+class LabDepthFloatSLIC : public FeatureSLIC<4, float, float>
+{
+public:
+
+	LabDepthFloatSLIC()
+	{
+		setValueRange(255.0);
+	}
+};
+
+/* Any stack of feature channels, e.g. [L, A, B, depth, flow x, flow y]. */
+typedef FeatureSLIC<DYNAMIC_CHANNELS, float, float> DynamicFeatureSLIC;
+
+/****************************************************************************/
+/*                       Feature SLIC implementation                        */
+/****************************************************************************/
+template <unsigned Channels, typename PixelT, typename DistanceT>
+FeatureSLIC<Channels, PixelT, DistanceT>::FeatureSLIC()
+{
+	this->pixelsNumber = 0;
+	this->channelsNumber = Channels;
+	this->weightedChannels = false;
+	this->samplingStep = 0;
+	this->valueRange = FeaturePixelTraits<PixelT>::range();
+	this->distanceFactor = 0;
+	this->clustersNumber = 0;
+	this->iterationIndex = 0;
+	this->totalResidualError = 0;
+}
+
+template <unsigned Channels, typename PixelT, typename DistanceT>
+void FeatureSLIC<Channels, PixelT, DistanceT>::initializeCentres(const cv::Mat& image)
+{
+	const unsigned channels = this->channels();
+	const unsigned centreSize = this->centreSize();
+
+	clusterCentres.clear();
+
+	for (int y = samplingStep; y < image.rows; y += samplingStep)
+		for (int x = samplingStep; x < image.cols; x += samplingStep)
+		{
+			const cv::Point lowestGradientPixel = findLowestGradient(image, cv::Point(x, y));
+			const size_t    centreIndex = clusterCentres.size();
+
+			/* Insert a [channels, x, y] centre in the centres vector. */
+			clusterCentres.resize(centreIndex + centreSize);
+			Kernels::copy(
+				image.ptr<PixelT>(lowestGradientPixel.y) + channels * lowestGradientPixel.x,
+				&clusterCentres[centreIndex], channels);
+			clusterCentres[centreIndex + channels] = static_cast<DistanceT>(lowestGradientPixel.x);
+			clusterCentres[centreIndex + channels + 1] = static_cast<DistanceT>(lowestGradientPixel.y);
+		}
+
+	clustersNumber = static_cast<unsigned>(clusterCentres.size() / centreSize);
+	previousClusterCentres = clusterCentres;
+	pixelsOfSameCluster.assign(clustersNumber, 0);
+	residualError.assign(clustersNumber, 0);
+}
+
+template <unsigned Channels, typename PixelT, typename DistanceT>
+cv::Point FeatureSLIC<Channels, PixelT, DistanceT>::findLowestGradient(
+	const cv::Mat&   image,
+	const cv::Point& centre) const
+{
+	const unsigned channels = this->channels();
+	double         lowestGradient = DBL_MAX;
+	cv::Point      lowestGradientPoint = centre;
+
+	for (int y = centre.y - 1; y <= centre.y + 1 && y < image.rows - 1; ++y)
+		for (int x = centre.x - 1; x <= centre.x + 1 && x < image.cols - 1; ++x)
+		{
+			/* Exclude pixels on borders. */
+			if (x < 1 || y < 1)
+				continue;
+
+			const double horizontal =
+				static_cast<double>(image.ptr<PixelT>(y)[channels * (x + 1)]) - image.ptr<PixelT>(y)[channels * (x - 1)];
+			const double vertical =
+				static_cast<double>(image.ptr<PixelT>(y - 1)[channels * x]) - image.ptr<PixelT>(y + 1)[channels * x];
+			const double tempGradient = horizontal * horizontal + vertical * vertical;
+
+			if (tempGradient < lowestGradient)
+			{
+				lowestGradient = tempGradient;
+				lowestGradientPoint = cv::Point(x, y);
+			}
+		}
+
+	return lowestGradientPoint;
+}
+
+template <unsigned Channels, typename PixelT, typename DistanceT>
+template <bool Weighted>
+void FeatureSLIC<Channels, PixelT, DistanceT>::assignClusterPixels(
+	const cv::Mat& image,
+	const unsigned centreIndex)
+{
+	const unsigned   channels = this->channels();
+	const DistanceT* weights = channelWeights.data();
+	const DistanceT* centre = &clusterCentres[centreSize() * centreIndex];
+	const DistanceT  centreX = centre[channels];
+	const DistanceT  centreY = centre[channels + 1];
+
+	/* The 2 x step by 2 x step search region, clipped to the image. */
+	const int firstX = std::max(static_cast<int>(centreX) - static_cast<int>(samplingStep) - 1, 0);
+	const int firstY = std::max(static_cast<int>(centreY) - static_cast<int>(samplingStep) - 1, 0);
+	const int endX = std::min(static_cast<int>(centreX) + static_cast<int>(samplingStep) + 2, image.cols);
+	const int endY = std::min(static_cast<int>(centreY) + static_cast<int>(samplingStep) + 2, image.rows);
+
+	for (int y = firstY; y < endY; ++y)
+	{
+		const PixelT*   pixel = image.ptr<PixelT>(y);
+		const DistanceT rowTerm = distanceFactor * (y - centreY) * (y - centreY);
+		DistanceT*      distance = &distanceFromClusterCentre[y * image.cols];
+		int*            label = &pixelCluster[y * image.cols];
+
+		for (int x = firstX; x < endX; ++x)
+		{
+			const DistanceT colorDistance = (Weighted) ?
+				Kernels::weightedColorDistance(pixel + channels * x, centre, weights, channels) :
+				Kernels::colorDistance(pixel + channels * x, centre, channels);
+
+			const DistanceT tempDistance =
+				colorDistance + rowTerm + distanceFactor * (x - centreX) * (x - centreX);
+
+			/* Ties go to the lowest cluster index, as in SLIC. */
+			if (tempDistance < distance[x] ||
+				(tempDistance == distance[x] && static_cast<int>(centreIndex) < label[x]))
+			{
+				distance[x] = tempDistance;
+				label[x] = centreIndex;
+			}
+		}
+	}
+}
+
+template <unsigned Channels, typename PixelT, typename DistanceT>
+void FeatureSLIC<Channels, PixelT, DistanceT>::assignPixels(const cv::Mat& image)
+{
+	const unsigned channels = this->channels();
+	const unsigned centreSize = this->centreSize();
+
+	/* A search region spans less than 2 x (step + 2) pixels around the
+	centre, as in SLIC::scheduleClusterAssignment. */
+	centresGrid.reset(image.cols, image.rows, samplingStep + 2);
+
+	for (unsigned centreIndex = 0; centreIndex < clustersNumber; ++centreIndex)
+		centresGrid.insert(centreIndex,
+			clusterCentres[centreSize * centreIndex + channels],
+			clusterCentres[centreSize * centreIndex + channels + 1]);
+
+	const int cellsPerRow = centresGrid.getCellsPerRow();
+	const int cellsPerColumn = centresGrid.getCellsPerColumn();
+
+	/* One parallel phase per colour; the clusters of a cell run one
+	after the other, so the labels are the same at every run. */
+	for (int colour = 0; colour < 9; ++colour)
+	{
+		const int firstCellX = colour % 3;
+		const int firstCellY = colour / 3;
+
+		if (firstCellX >= cellsPerRow || firstCellY >= cellsPerColumn)
+			continue;
+
+		const int colourCellsPerRow = (cellsPerRow - firstCellX + 2) / 3;
+		const int colourCellsPerColumn = (cellsPerColumn - firstCellY + 2) / 3;
+
+		tbb::parallel_for(0, colourCellsPerRow * colourCellsPerColumn, 1, [&](int n)
+		{
+			const std::vector<unsigned>& cellCentres = centresGrid.getCellCentres(
+				firstCellX + 3 * (n % colourCellsPerRow), firstCellY + 3 * (n / colourCellsPerRow));
+
+			for (const unsigned centreIndex : cellCentres)
+				if (weightedChannels)
+					assignClusterPixels<true>(image, centreIndex);
+				else
+					assignClusterPixels<false>(image, centreIndex);
+		});
+	}
+}
+
+template <unsigned Channels, typename PixelT, typename DistanceT>
+void FeatureSLIC<Channels, PixelT, DistanceT>::updateCentres(const cv::Mat& image)
+{
+	const unsigned channels = this->channels();
+	const unsigned centreSize = this->centreSize();
+
+	centreSums.assign(centreSize * clustersNumber, 0);
+	pixelsOfSameCluster.assign(clustersNumber, 0);
+
+	for (int y = 0; y < image.rows; ++y)
+	{
+		const PixelT* pixel = image.ptr<PixelT>(y);
+		const int*    label = &pixelCluster[y * image.cols];
+
+		for (int x = 0; x < image.cols; ++x)
+			if (label[x] != -1)
+			{
+				double* sums = &centreSums[centreSize * label[x]];
+
+				Kernels::accumulate(pixel + channels * x, sums, channels);
+				sums[channels] += x;
+				sums[channels + 1] += y;
+
+				++pixelsOfSameCluster[label[x]];
+			}
+	}
+
+	/* Normalize the clusters' centres; empty clusters keep their position. */
+	tbb::parallel_for<unsigned>(0, clustersNumber, 1, [=](unsigned centreIndex)
+	{
+		DistanceT*    centre = &clusterCentres[centreSize * centreIndex];
+		const double* sums = &centreSums[centreSize * centreIndex];
+
+		if (pixelsOfSameCluster[centreIndex] == 0)
+			for (unsigned n = 0; n < centreSize; ++n)
+				centre[n] = previousClusterCentres[centreSize * centreIndex + n];
+		else
+			for (unsigned n = 0; n < centreSize; ++n)
+				centre[n] = static_cast<DistanceT>(sums[n] / pixelsOfSameCluster[centreIndex]);
+	});
+}
+
+template <unsigned Channels, typename PixelT, typename DistanceT>
+void FeatureSLIC<Channels, PixelT, DistanceT>::updateResidualError(const unsigned centreIndex)
+{
+	const unsigned   channels = this->channels();
+	const unsigned   centreSize = this->centreSize();
+	const DistanceT* centre = &clusterCentres[centreSize * centreIndex];
+	DistanceT*       previousCentre = &previousClusterCentres[centreSize * centreIndex];
+
+	/* The feature shift is measured as the assignment does, and brought
+	to pixels by the spatial weight. */
+	double featureShift = 0;
+
+	for (unsigned channel = 0; channel < channels; ++channel)
+	{
+		const double difference = static_cast<double>(centre[channel]) - previousCentre[channel];
+		featureShift += ((weightedChannels) ? channelWeights[channel] : 1) * difference * difference;
+	}
+
+	const double shiftX = static_cast<double>(centre[channels]) - previousCentre[channels];
+	const double shiftY = static_cast<double>(centre[channels + 1]) - previousCentre[channels + 1];
+
+	residualError[centreIndex] = sqrt(shiftX * shiftX + shiftY * shiftY +
+		((distanceFactor > 0) ? featureShift / distanceFactor : 0));
+
+	for (unsigned n = 0; n < centreSize; ++n)
+		previousCentre[n] = centre[n];
+}
+
+template <unsigned Channels, typename PixelT, typename DistanceT>
+bool FeatureSLIC<Channels, PixelT, DistanceT>::createSuperpixels(
+	const cv::Mat& image,
+	const unsigned samplingStep,
+	const unsigned spatialDistanceWeight,
+	const unsigned iterationNumber,
+	const double   errorThreshold)
+{
+	if (image.depth() != FeaturePixelTraits<PixelT>::depth || samplingStep == 0 ||
+		(Channels != DYNAMIC_CHANNELS && image.channels() != static_cast<int>(Channels)))
+		return false;
+
+	channelsNumber = image.channels();
+
+	/* Missing weights are 1. */
+	if (channelWeights.size() < channelsNumber)
+		channelWeights.resize(channelsNumber, 1);
+
+	/* Distances are computed in the units of the pixel values. */
+	const double range = valueRange / 255.0;
+
+	this->pixelsNumber = image.rows * image.cols;
+	this->samplingStep = samplingStep;
+	this->distanceFactor = static_cast<DistanceT>(
+		range * range * spatialDistanceWeight * spatialDistanceWeight / (samplingStep * samplingStep));
+
+	initializeCentres(image);
+
+	pixelCluster.assign(pixelsNumber, -1);
+
+	for (iterationIndex = 0; iterationIndex < iterationNumber; ++iterationIndex)
+	{
+		/* Reset distance values. */
+		distanceFromClusterCentre.assign(pixelsNumber, std::numeric_limits<DistanceT>::max());
+
+		assignPixels(image);
+
+		updateCentres(image);
+
+		/* Compute the residual error and stop when it is low enough. */
+		tbb::parallel_for<unsigned>(0, clustersNumber, 1, [=](unsigned centreIndex)
+		{
+			updateResidualError(centreIndex);
+		});
+
+		totalResidualError = 0;
+
+		for (unsigned centreIndex = 0; centreIndex < clustersNumber; ++centreIndex)
+			totalResidualError += residualError[centreIndex];
+
+		if (clustersNumber != 0)
+			totalResidualError /= clustersNumber;
+
+		if (errorThreshold > 0 && iterationIndex > 0 && totalResidualError < errorThreshold)
+		{
+			++iterationIndex;
+			break;
+		}
+	}
+
+	return true;
+}
+
+template <unsigned Channels, typename PixelT, typename DistanceT>
+void FeatureSLIC<Channels, PixelT, DistanceT>::setChannelWeights(const std::vector<double>& weights)
+{
+	channelWeights.assign(weights.begin(), weights.end());
+	weightedChannels = false;
+
+	for (size_t channel = 0; channel < weights.size(); ++channel)
+		if (weights[channel] != 1)
+			weightedChannels = true;
+}
+
+template <unsigned Channels, typename PixelT, typename DistanceT>
+void FeatureSLIC<Channels, PixelT, DistanceT>::setValueRange(const double range)
+{
+	this->valueRange = range;
+}
+
+template <unsigned Channels, typename PixelT, typename DistanceT>
+bool FeatureSLIC<Channels, PixelT, DistanceT>::stackFeatures(
+	const std::vector<cv::Mat>& features,
+	cv::Mat&                    image)
+{
+	if (features.empty())
+		return false;
+
+	int channels = 0;
+
+	for (const cv::Mat& feature : features)
+	{
+		if (feature.depth() != FeaturePixelTraits<PixelT>::depth ||
+			feature.rows != features[0].rows || feature.cols != features[0].cols)
+			return false;
+
+		channels += feature.channels();
+	}
+
+	image.create(features[0].rows, features[0].cols, CV_MAKETYPE(FeaturePixelTraits<PixelT>::depth, channels));
+
+	for (int y = 0; y < image.rows; ++y)
+	{
+		PixelT* destination = image.ptr<PixelT>(y);
+		int     firstChannel = 0;
+
+		for (const cv::Mat& feature : features)
+		{
+			const PixelT* source = feature.ptr<PixelT>(y);
+			const int     featureChannels = feature.channels();
+
+			for (int x = 0; x < image.cols; ++x)
+				for (int channel = 0; channel < featureChannels; ++channel)
+					destination[channels * x + firstChannel + channel] = source[featureChannels * x + channel];
+
+			firstChannel += featureChannels;
+		}
+	}
+
+	return true;
+}
+
+template <unsigned Channels, typename PixelT, typename DistanceT>
+const std::vector<int>& FeatureSLIC<Channels, PixelT, DistanceT>::getPixelClusters() const
+{
+	return pixelCluster;
+}
+
+template <unsigned Channels, typename PixelT, typename DistanceT>
+const std::vector<DistanceT>& FeatureSLIC<Channels, PixelT, DistanceT>::getClusterCentres() const
+{
+	return clusterCentres;
+}
+
+#endif
@@ -0,0 +1,134 @@
+/****************************************************************************/
+/*                                                                          */
+/* Filename:       FrameParallelSLIC.cpp                                    */
+/*                                                                          */
+/* File base:      FrameParallelSLIC                                        */
+/* File extension: cpp                                                      */
+/*                                                                          */
+/* Purpose:        SLIC superpixels of independent video frames, several    */
+/*                 frames in flight at once, each with its own workspace,   */
+/*                 delivered in the order they were read                    */
+/*                                                                          */
+/****************************************************************************/
+
+#include "FrameParallelSLIC.h"
+
+/* Boost libraries. */
+#include <boost/chrono.hpp>
+
+using namespace cv;
+
+/****************************************************************************/
+/*                          Frame Parallel SLIC                             */
+/****************************************************************************/
+FrameParallelSLIC::FrameParallelSLIC(const unsigned framesInFlight)
+{
+	this->framesInFlight = (framesInFlight != 0) ?
+		framesInFlight : static_cast<unsigned>(tbb::this_task_arena::max_concurrency());
+}
+
+unsigned FrameParallelSLIC::getFramesInFlight() const
+{
+	return framesInFlight;
+}
+
+unsigned FrameParallelSLIC::createSuperpixels(
+	const FrameReader&   readFrame,
+	const FrameWriter&   writeFrame,
+	const unsigned       samplingStep,
+	const unsigned       spatialDistanceWeight,
+	const unsigned       iterationNumber,
+	const double         errorThreshold,
+	SLICElaborationMode  SLICMode,
+	VideoElaborationMode videoMode,
+	const unsigned       keyFramesRatio,
+	const double         GaussianStdDev)
+{
+	/* The workspaces are kept across calls, so that their buffers are
+	only allocated for the first frames. Independent frames have no
+	identities to keep, so they do not track them. */
+	while (workspaces.size() < framesInFlight)
+		workspaces.push_back(std::unique_ptr<SLIC>(new SLIC()));
+
+	frames.resize(framesInFlight);
+	elapsedTimes.assign(framesInFlight, 0);
+
+	unsigned framesNumber = 0;
+	bool     lastFrameRead = false;
+
+	/* The frames leave the pipeline in order and at most framesInFlight
+	are inside it, so the frame n + framesInFlight is read only after the
+	frame n has been written and its slot can be reused. */
+	tbb::parallel_pipeline(framesInFlight,
+		tbb::make_filter<void, unsigned>(tbb::filter_mode::serial_in_order,
+			[&](tbb::flow_control& control) -> unsigned
+	{
+		const unsigned frameIndex = framesNumber;
+
+		SLIC_TRACE_SCOPE("read", "pipeline", frameIndex);
+
+		if (lastFrameRead || readFrame(frames[frameIndex % framesInFlight]) == false ||
+			frames[frameIndex % framesInFlight].data == NULL)
+		{
+			lastFrameRead = true;
+			control.stop();
+			return 0;
+		}
+
+		++framesNumber;
+		return frameIndex;
+	}) &
+		tbb::make_filter<unsigned, unsigned>(tbb::filter_mode::parallel,
+			[&](unsigned frameIndex) -> unsigned
+	{
+		const unsigned slot = frameIndex % framesInFlight;
+
+		SLIC_TRACE_SCOPE("elaborate", "pipeline", frameIndex);
+
+		boost::chrono::high_resolution_clock::time_point startPoint =
+			boost::chrono::high_resolution_clock::now();
+
+		Mat& frame = frames[slot];
+
+		if (frame.type() == CV_8UC1)
+		{
+			/* NV12 frame: the Y rows are two thirds of the matrix. */
+			const int frameHeight = 2 * frame.rows / 3;
+
+			workspaces[slot]->createSuperpixels(
+				PlanarImage::fromNV12(
+					frameHeight, frame.cols, frame.ptr<uchar>(0), frame.ptr<uchar>(frameHeight),
+					frame.step, frame.step),
+				samplingStep, spatialDistanceWeight, iterationNumber, errorThreshold,
+				SLICMode, videoMode, keyFramesRatio, GaussianStdDev, false);
+		}
+		else
+		{
+			/* Convert the frame from RGB to LAB color space
+			before SLIC elaboration. */
+			cvtColor(frame, frame, CV_BGR2Lab);
+
+			workspaces[slot]->createSuperpixels(
+				frame, samplingStep, spatialDistanceWeight, iterationNumber, errorThreshold,
+				SLICMode, videoMode, keyFramesRatio, GaussianStdDev, false);
+		}
+
+		boost::chrono::high_resolution_clock::time_point endPoint =
+			boost::chrono::high_resolution_clock::now();
+
+		elapsedTimes[slot] = boost::chrono::duration<double, boost::milli>(endPoint - startPoint).count();
+
+		return frameIndex;
+	}) &
+		tbb::make_filter<unsigned, void>(tbb::filter_mode::serial_in_order,
+			[&](unsigned frameIndex)
+	{
+		const unsigned slot = frameIndex % framesInFlight;
+
+		SLIC_TRACE_SCOPE("write", "pipeline", frameIndex);
+
+		writeFrame(frameIndex, *workspaces[slot], frames[slot], elapsedTimes[slot]);
+	}));
+
+	return framesNumber;
+}
@@ -0,0 +1,77 @@
+/****************************************************************************/
+/*                                                                          */
+/* Filename:       FrameParallelSLIC.h                                      */
+/*                                                                          */
+/* File base:      FrameParallelSLIC                                        */
+/* File extension: h                                                        */
+/*                                                                          */
+/* Purpose:        SLIC superpixels of independent video frames, several    */
+/*                 frames in flight at once, each with its own workspace,   */
+/*                 delivered in the order they were read                    */
+/*                                                                          */
+/****************************************************************************/
+
+#ifndef FRAMEPARALLELSLIC_H
+#define FRAMEPARALLELSLIC_H
+
+#include "SLIC.h"
+
+#include <functional>
+#include <memory>
+
+/****************************************************************************/
+/*                          Frame Parallel SLIC                             */
+/****************************************************************************/
+class FrameParallelSLIC
+{
+protected:
+
+	/* Maximum number of frames being read, elaborated or written at once. */
+	unsigned framesInFlight;
+
+	/* One SLIC workspace and one frame per frame in flight: the frame with
+	   index n uses the slot n % framesInFlight. */
+	std::vector<std::unique_ptr<SLIC>> workspaces;
+	std::vector<cv::Mat>               frames;
+
+	/* Elaboration time of the frame in each slot, in milliseconds. */
+	std::vector<double> elapsedTimes;
+
+public:
+
+	/* Receive a frame read by readFrame (in BGR, as given by
+	   cv::VideoCapture, or in NV12 as decoded: a single-channel matrix
+	   holding the Y rows followed by the interleaved U, V rows) and store
+	   it in the given matrix. Return false when there are no more frames. */
+	typedef std::function<bool(cv::Mat&)> FrameReader;
+
+	/* Receive the index of a frame, the SLIC workspace holding its
+	   superpixels, the frame in Lab (or in NV12, as read) and its
+	   elaboration time in milliseconds. Called in frame order, one frame
+	   at a time. */
+	typedef std::function<void(unsigned, const SLIC&, const cv::Mat&, double)> FrameWriter;
+
+	/* Class constructor: zero frames in flight means one per thread. */
+	FrameParallelSLIC(const unsigned framesInFlight = 0);
+
+	/* Number of frames kept in flight. */
+	unsigned getFramesInFlight() const;
+
+	/* Elaborate all the frames given by readFrame, as independent frames
+	   (connectedFrames == false), and pass them to writeFrame in order.
+	   NV12 frames are clustered in YUV. Return the number of frames
+	   elaborated. */
+	unsigned createSuperpixels(
+		const FrameReader&   readFrame,
+		const FrameWriter&   writeFrame,
+		const unsigned       samplingStep,
+		const unsigned       spatialDistanceWeight,
+		const unsigned       iterationNumber,
+		const double         errorThreshold,
+		SLICElaborationMode  SLICMode,
+		VideoElaborationMode videoMode,
+		const unsigned       keyFramesRatio,
+		const double         GaussianStdDev);
+};
+
+#endif
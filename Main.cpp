@@ -10,6 +10,9 @@
 /****************************************************************************/
 
 #include "SLIC.h"
+#include "FrameParallelSLIC.h"
+#include "WavefrontSLIC.h"
+#include "TiledSLIC.h"
 
 /* Deletion of unuseful includes: they're in the header SLIC.h*/
 
@@ -27,7 +30,81 @@ int VideoSLIC(
 	double               errorThreshold,
 	VideoElaborationMode videoMode,
 	unsigned             keyFramesRatio,
-	double               GaussianStdDev
+	double               GaussianStdDev,
+	bool                 NV12Input
+	);
+
+/* Function performing SLIC algorithm on independent video frames,
+   several of them at once. */
+int VideoSLICFrameParallel(
+	VideoCapture&        capturedVideo,
+	unsigned             superpixelNumber,
+	unsigned             spatialDistanceWeight,
+	SLICElaborationMode  SLICMode,
+	unsigned             iterationNumber,
+	double               errorThreshold,
+	VideoElaborationMode videoMode,
+	unsigned             keyFramesRatio,
+	double               GaussianStdDev,
+	unsigned             framesInFlight,
+	bool                 NV12Input
+	);
+
+/* Function performing SLIC algorithm on connected video frames, each
+   frame starting before the previous one has finished. */
+int VideoSLICWavefront(
+	VideoCapture&        capturedVideo,
+	unsigned             superpixelNumber,
+	unsigned             spatialDistanceWeight,
+	SLICElaborationMode  SLICMode,
+	unsigned             iterationNumber,
+	double               errorThreshold,
+	VideoElaborationMode videoMode,
+	unsigned             keyFramesRatio,
+	double               GaussianStdDev,
+	unsigned             lagIterations,
+	bool                 strictChainComparison,
+	bool                 NV12Input
+	);
+
+/* Read the next frame of a video: in NV12 while NV12Input holds, else
+   in BGR. NV12Input is cleared, and the backend switched back to BGR,
+   at the first frame which is not in NV12. Return false at the end of
+   the video. */
+bool ReadVideoFrame(
+	VideoCapture&  capturedVideo,
+	Mat&           frame,
+	unsigned       videoHeight,
+	bool&          NV12Input
+	);
+
+/* Function timing SLIC on the first frame of a video, scaled to a given
+   size, for superpixel numbers from 100 to 500000, then comparing the
+   fixed-point and double precision iterations and the assignment
+   schedules. Return -1 if the labels of the compared elaborations do not
+   agree as expected. */
+int BenchmarkSLIC(
+	VideoCapture&  capturedVideo,
+	unsigned       spatialDistanceWeight,
+	unsigned       iterationNumber,
+	unsigned       benchmarkWidth,
+	unsigned       benchmarkHeight,
+	unsigned       repetitions
+	);
+
+/* Function performing SLIC algorithm tile by tile on a raw BGR image too
+   large for the memory, optionally comparing its labels along the seams
+   between tiles with those of one elaboration of the whole image. */
+int TiledImageSLIC(
+	const string&  imageLocation,
+	unsigned       imageWidth,
+	unsigned       imageHeight,
+	const string&  labelsLocation,
+	unsigned       tileSize,
+	unsigned       superpixelNumber,
+	unsigned       spatialDistanceWeight,
+	unsigned       iterationNumber,
+	bool           seamComparison
 	);
 
 int main(int argc, char *argv[])
@@ -39,6 +116,42 @@ int main(int argc, char *argv[])
 	/* Output window name. */
 	const string windowName = "VideoSLIC";
 
+	/* SLIC algorithm parameters. */
+	unsigned spatialDistanceWeight = 30;
+	unsigned superpixelNumber = 1000;
+	/* There's no need to set both iterationNumber and errorThreshold,
+	   it's enough to set only one of them and set the other one to zero.
+	   Which of the two values will be used for video elaboration depends
+	   on the value of the field SLICMode. */
+	unsigned iterationNumber = 10;
+	double   errorThreshold = 0.25;
+
+	/* Raw BGR image (width x height, no header), or TIFF image (8-bit RGB
+	   in uncompressed strips, whose size is read from the file), elaborated
+	   tile by tile instead of the video when not empty; the labels are
+	   written to tiledLabelsLocation as 32-bit integers. With
+	   tiledSeamComparison, the whole image is also elaborated at once (it
+	   must then fit in the memory) to check the labels along the seams
+	   between tiles. */
+	const string   tiledImageLocation = "";
+	const unsigned tiledImageWidth = 0;
+	const unsigned tiledImageHeight = 0;
+	const string   tiledLabelsLocation = "labels.raw";
+	const unsigned tileSize = 2048;
+	const bool     tiledSeamComparison = false;
+
+	if (tiledImageLocation.empty() == false)
+		return TiledImageSLIC(
+			tiledImageLocation,
+			tiledImageWidth,
+			tiledImageHeight,
+			tiledLabelsLocation,
+			tileSize,
+			superpixelNumber,
+			spatialDistanceWeight,
+			iterationNumber,
+			tiledSeamComparison);
+
 	/* Declare a container for the video and try to import the video from
 	   a specific location. */
 	VideoCapture capturedVideo(videoLocation);
@@ -52,16 +165,6 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
-	/* SLIC algorithm parameters. */
-	unsigned spatialDistanceWeight = 30;
-	unsigned superpixelNumber = 1000;
-	/* There's no need to set both iterationNumber and errorThreshold,
-	   it's enough to set only one of them and set the other one to zero.
-	   Which of the two values will be used for video elaboration depends
-	   on the value of the field SLICMode. */
-	unsigned iterationNumber = 10;
-	double   errorThreshold = 0.25;
-
 	/* Compute SLIC algorithm step for later use in generating Gaussian noise. */
 	const unsigned videoWidth = static_cast<unsigned>(capturedVideo.get(CV_CAP_PROP_FRAME_WIDTH));
 	const unsigned videoHeight = static_cast<unsigned>(capturedVideo.get(CV_CAP_PROP_FRAME_HEIGHT));
@@ -78,6 +181,87 @@ int main(int argc, char *argv[])
 	unsigned             keyFramesRatio = 30;
 	/* Standard deviation of the Gaussian noise. */
 	double               GaussianStdDev = static_cast<double>(stepSLIC / 5);
+	/* Take the frames as decoded (NV12) and cluster them in YUV, without
+	   converting them to BGR and then to Lab. When the backend does not
+	   give NV12 frames, it is switched back to BGR and the frames are
+	   converted to Lab. */
+	bool                 NV12Input = false;
+	/* With connectedFrames = false, keep framesInFlight frames in
+	   elaboration at once (0 means one per thread, 1 disables it). */
+	unsigned             framesInFlight = 0;
+	/* With connectedFrames = true, start each frame from the centres of
+	   the previous one after wavefrontLag iterations (0 keeps the strict
+	   chain), optionally reporting the difference with the strict chain. */
+	unsigned             wavefrontLag = 0;
+	bool                 strictChainComparison = false;
+	/* Time the first frame, at 4K, for a sweep of superpixel numbers
+	   instead of elaborating the video (also set by --benchmark). */
+	bool                 benchmarkSuperpixels =
+		std::find(argv + 1, argv + argc, string("--benchmark")) != argv + argc;
+
+#ifdef SLIC_INSTRUMENTATION
+	/* Record a timeline of frames, iterations, phases and task ranges in
+	   this file (empty for none), written when the program ends; it opens
+	   in chrome://tracing and in the Perfetto UI. */
+	const string traceLocation = "";
+	std::unique_ptr<SLICTraceWriter> traceWriter(
+		traceLocation.empty() ? nullptr : new SLICTraceWriter(traceLocation));
+
+	/* Count cycles, instructions, last level cache and branch misses of
+	   each phase (Linux only; the phases are still timed when the counters
+	   are not permitted), also set by --counters. Opened before any
+	   parallel work, so that all the worker threads are counted. */
+	const bool hardwareCounters =
+		std::find(argv + 1, argv + argc, string("--counters")) != argv + argc;
+	std::unique_ptr<SLICPerfCounters> perfCounters(
+		hardwareCounters ? new SLICPerfCounters() : nullptr);
+
+	if (perfCounters && perfCounters->getStatus().empty() == false)
+		cout << perfCounters->getStatus() << endl;
+#endif
+
+	if (benchmarkSuperpixels)
+		return BenchmarkSLIC(
+			capturedVideo,
+			spatialDistanceWeight,
+			iterationNumber,
+			3840,
+			2160,
+			3);
+
+	/* Independent frames have no dependency on each other. */
+	if (connectedFrames == false && framesInFlight != 1)
+		return VideoSLICFrameParallel(
+			capturedVideo,
+			superpixelNumber,
+			spatialDistanceWeight,
+			SLICMode,
+			iterationNumber,
+			errorThreshold,
+			VideoMode,
+			keyFramesRatio,
+			GaussianStdDev,
+			framesInFlight,
+			NV12Input);
+
+	/* Connected frames only depend on the centres of the previous one,
+	except in the modes reusing its labels. */
+	if (connectedFrames && wavefrontLag != 0 && WavefrontSLIC::supportsVideoMode(VideoMode) == false)
+		cout << "This video mode cannot be pipelined: frames are elaborated in sequence." << endl;
+	else if (connectedFrames && wavefrontLag != 0)
+		return VideoSLICWavefront(
+			capturedVideo,
+			superpixelNumber,
+			spatialDistanceWeight,
+			SLICMode,
+			iterationNumber,
+			errorThreshold,
+			VideoMode,
+			keyFramesRatio,
+			GaussianStdDev,
+			wavefrontLag,
+			strictChainComparison,
+			NV12Input);
 
 	/* Call function to perform SLIC algorithm operations on video. */
 	VideoSLIC(
@@ -90,7 +274,8 @@ int main(int argc, char *argv[])
 		errorThreshold,
 		VideoMode,
 		keyFramesRatio,
-		GaussianStdDev);
+		GaussianStdDev,
+		NV12Input);
 
 	return 0;
 }
@@ -105,7 +290,8 @@ int VideoSLIC(
 	double               errorThreshold,
 	VideoElaborationMode videoMode,
 	unsigned             keyFramesRatio,
-	double               GaussianStdDev
+	double               GaussianStdDev,
+	bool                 NV12Input
 	)
 {
 	/* Get video width and height. */
@@ -118,10 +304,17 @@ int VideoSLIC(
 	/* Create an object for SLIC algorithm operations. */
 	SLIC* SLICFrame = new SLIC();
 
+	/* The births and deaths of superpixels are reported for each frame. */
+	SLICFrame->setIdentityTracking(true);
+
 	/* A container which will hold a video frame for
 	   the time necessary for its elaboration. */
 	Mat currentFrame;
 
+	/* Ask the backend not to convert the decoded frames to BGR. */
+	if (NV12Input)
+		capturedVideo.set(CV_CAP_PROP_CONVERT_RGB, 0);
+
 	/* Video frames counter. */
 	unsigned framesNumber = 0;
 
@@ -156,14 +349,44 @@ int VideoSLIC(
 		if (currentFrame.data == NULL)
 			break;
 
-		/* Convert the frame from RGB to LAB color space
-		   before SLIC elaboration. */
-		cvtColor(currentFrame, currentFrame, CV_BGR2Lab);
+		/* An NV12 frame is a single-channel matrix holding the Y rows
+		   followed by half as many rows (rounded up) of interleaved U, V
+		   samples. */
+		const bool NV12Frame = NV12Input && currentFrame.type() == CV_8UC1 &&
+			currentFrame.rows == static_cast<int>(videoHeight + (videoHeight + 1) / 2);
+
+		/* The backend does not give NV12 frames: let it convert them to BGR
+		   again, and skip this raw frame, which cannot be converted. */
+		if (NV12Input && NV12Frame == false)
+		{
+			NV12Input = false;
+			capturedVideo.set(CV_CAP_PROP_CONVERT_RGB, 1);
+
+			if (currentFrame.channels() != 3)
+				continue;
+		}
+
+		if (NV12Frame)
+		{
+			/* Perform the SLIC algorithm operations directly on YUV. */
+			SLICFrame->createSuperpixels(
+				PlanarImage::fromNV12(
+					videoHeight, videoWidth, currentFrame.ptr<uchar>(0), currentFrame.ptr<uchar>(videoHeight),
+					currentFrame.step, currentFrame.step),
+				stepSLIC, spatialDistanceWeight, iterationNumber, errorThreshold,
+				SLICMode, videoMode, keyFramesRatio, GaussianStdDev, connectedFrames);
+		}
+		else
+		{
+			/* Convert the frame from RGB to LAB color space
+			   before SLIC elaboration. */
+			cvtColor(currentFrame, currentFrame, CV_BGR2Lab);
 
-		/* Perform the SLIC algorithm operations. */
-		SLICFrame->createSuperpixels(
-			currentFrame, stepSLIC, spatialDistanceWeight, iterationNumber, errorThreshold,
-			SLICMode, videoMode, keyFramesRatio, GaussianStdDev, connectedFrames);
+			/* Perform the SLIC algorithm operations. */
+			SLICFrame->createSuperpixels(
+				currentFrame, stepSLIC, spatialDistanceWeight, iterationNumber, errorThreshold,
+				SLICMode, videoMode, keyFramesRatio, GaussianStdDev, connectedFrames);
+		}
 		//SLICFrame->enforceConnectivity(currentFrame);
 		//SLICFrame->colorSuperpixels(currentFrame);
 
@@ -183,6 +406,7 @@ int VideoSLIC(
 			boost::chrono::duration_cast<boost::chrono::milliseconds>(endPoint - startPoint);
 
 		++framesNumber;
+		SLICFrame->updateStatistics(elapsedTime.count());
 		//SLICFrame->drawInformation(currentFrame, framesNumber, elapsedTime.count());
 
 		///* Commented in STUDY USE ONLY */
@@ -196,20 +420,67 @@ int VideoSLIC(
 		avgIterations += (SLICFrame->iterationIndex);
 		stdDeviation = sqrt(framesNumber * totalTime2 - totalTime * totalTime) / framesNumber;
 
+		/* Count the superpixel identities created and lost in this frame. */
+		unsigned births = 0;
+		unsigned deaths = 0;
+		for (const SuperpixelEvent& event : SLICFrame->getSuperpixelEvents())
+			(event.type == SUPERPIXEL_BIRTH) ? ++births : ++deaths;
+		SLICFrame->clearSuperpixelEvents();
+
+		/* Report how the superpixels of this frame have been obtained. */
+		const char* framePath =
+			(SLICFrame->getLastFramePath() == LABELS_PROPAGATION) ? "propagated" :
+			(SLICFrame->getLastFramePath() == FROZEN_BACKGROUND) ? "frozen" : "full";
+
+		/* Modelled memory traffic of the assignment, when bands are swept. */
+		const BandSweepStatistics& bandSweep = SLICFrame->getBandSweepStatistics();
+
 		cout << "Frame: " << framesNumber 
+			<< "   path: " << framePath
 			<< "   ex. time now: "	<< elapsedTime.count() 
 			<< "   average ex. time: " << avgTime
 			<< "   numOfCentres: " << SLICFrame->clustersNumber
+			<< "   activeCentres: " << SLICFrame->getActiveClustersNumber()
 			<< "   stdDev: " << stdDeviation 
 			<< "   numOfIterations: " << SLICFrame->iterationIndex
 			<< "   average iterations: " << avgIterations / framesNumber
-			<< endl << endl;
+			<< "   births: " << births
+			<< "   deaths: " << deaths;
+
+		if (bandSweep.bandsNumber != 0)
+			cout << "   band traffic model per iteration (MB): " << bandSweep.sweepBytes / 1048576.0
+				<< " instead of " << bandSweep.searchRegionsBytes / 1048576.0;
+
+#ifdef SLIC_INSTRUMENTATION
+		/* Bytes actually loaded from memory by the assignment, when the
+		   hardware counters are read (last level cache misses of 64 bytes). */
+		const std::deque<SLICFrameRecord>& frameRecords = SLICFrame->getInstrumentation().getFrames();
+
+		if (frameRecords.empty() == false && frameRecords.back().phaseCounters[PHASE_ASSIGNMENT][PERF_CYCLES] != 0)
+			cout << "   measured assignment traffic per iteration (MB): "
+				<< 64.0 * frameRecords.back().phaseCounters[PHASE_ASSIGNMENT][PERF_LLC_MISSES] /
+					std::max(SLICFrame->iterationIndex, 1u) / 1048576.0;
+#endif
+
+		cout << endl;
+
+#ifdef SLIC_INSTRUMENTATION
+		/* Time of each phase of this frame. */
+		SLICFrame->getInstrumentation().printLastFrame(cout);
+#endif
+
+		cout << endl;
 
 		/* End program on ESC press. */
 		if (cvWaitKey(1) == 27)
 			break;
 	}
 
+#ifdef SLIC_INSTRUMENTATION
+	/* Average time of each phase over the video. */
+	SLICFrame->getInstrumentation().printSummary(cout);
+#endif
+
 	/* Free used memory before closing the program. */
 	if (SLICFrame != NULL)
 		delete SLICFrame;
@@ -220,4 +491,559 @@ int VideoSLIC(
 	cv::destroyAllWindows();
 
 	return 0;
-}
\ No newline at end of file
+}
+
+int VideoSLICFrameParallel(
+	VideoCapture&        capturedVideo,
+	unsigned             superpixelNumber,
+	unsigned             spatialDistanceWeight,
+	SLICElaborationMode  SLICMode,
+	unsigned             iterationNumber,
+	double               errorThreshold,
+	VideoElaborationMode videoMode,
+	unsigned             keyFramesRatio,
+	double               GaussianStdDev,
+	unsigned             framesInFlight,
+	bool                 NV12Input
+	)
+{
+	/* Get video width and height. */
+	const unsigned videoWidth = static_cast<unsigned>(capturedVideo.get(CV_CAP_PROP_FRAME_WIDTH));
+	const unsigned videoHeight = static_cast<unsigned>(capturedVideo.get(CV_CAP_PROP_FRAME_HEIGHT));
+
+	/* Compute the sampling step and round to the nearest integer. */
+	unsigned stepSLIC = static_cast<unsigned>(sqrt((videoHeight * videoWidth) / superpixelNumber) + 0.5);
+
+	/* Each frame in flight has its own SLIC workspace. */
+	FrameParallelSLIC SLICFrames(framesInFlight);
+
+	/* Ask the backend not to convert the decoded frames to BGR. */
+	if (NV12Input)
+		capturedVideo.set(CV_CAP_PROP_CONVERT_RGB, 0);
+
+	/* Debug data. */
+	double totalTime = 0;
+	double avgIterations = 0;
+
+	boost::chrono::high_resolution_clock::time_point startPoint =
+		boost::chrono::high_resolution_clock::now();
+
+	/* Frames are read one at a time and printed in order, while
+	   several of them are elaborated. */
+	const unsigned framesNumber = SLICFrames.createSuperpixels(
+		[&](Mat& frame)
+		{
+			return ReadVideoFrame(capturedVideo, frame, videoHeight, NV12Input);
+		},
+		[&](unsigned frameIndex, const SLIC& frameSLIC, const Mat&, double elapsedTime)
+		{
+			totalTime += elapsedTime;
+			avgIterations += frameSLIC.iterationIndex;
+
+			cout << "Frame: " << frameIndex + 1
+				<< "   ex. time now: " << elapsedTime
+				<< "   average ex. time: " << totalTime / (frameIndex + 1)
+				<< "   numOfCentres: " << frameSLIC.clustersNumber
+				<< "   numOfIterations: " << frameSLIC.iterationIndex
+				<< "   average iterations: " << avgIterations / (frameIndex + 1)
+				<< endl << endl;
+		},
+		stepSLIC, spatialDistanceWeight, iterationNumber, errorThreshold,
+		SLICMode, videoMode, keyFramesRatio, GaussianStdDev);
+
+	boost::chrono::high_resolution_clock::time_point endPoint =
+		boost::chrono::high_resolution_clock::now();
+
+	/* Frames elaborated per second, with all the frames in flight. */
+	const double wallTime = boost::chrono::duration<double>(endPoint - startPoint).count();
+
+	cout << "Frames: " << framesNumber
+		<< "   frames in flight: " << SLICFrames.getFramesInFlight()
+		<< "   frames per second: " << ((wallTime > 0) ? framesNumber / wallTime : 0)
+		<< endl;
+
+	cin.ignore();
+
+	return 0;
+}
+
+int VideoSLICWavefront(
+	VideoCapture&        capturedVideo,
+	unsigned             superpixelNumber,
+	unsigned             spatialDistanceWeight,
+	SLICElaborationMode  SLICMode,
+	unsigned             iterationNumber,
+	double               errorThreshold,
+	VideoElaborationMode videoMode,
+	unsigned             keyFramesRatio,
+	double               GaussianStdDev,
+	unsigned             lagIterations,
+	bool                 strictChainComparison,
+	bool                 NV12Input
+	)
+{
+	/* Get video width and height. */
+	const unsigned videoWidth = static_cast<unsigned>(capturedVideo.get(CV_CAP_PROP_FRAME_WIDTH));
+	const unsigned videoHeight = static_cast<unsigned>(capturedVideo.get(CV_CAP_PROP_FRAME_HEIGHT));
+
+	/* Compute the sampling step and round to the nearest integer. */
+	unsigned stepSLIC = static_cast<unsigned>(sqrt((videoHeight * videoWidth) / superpixelNumber) + 0.5);
+
+	/* Two frames overlap at any time. */
+	WavefrontSLIC SLICFrames(lagIterations);
+	SLICFrames.setStrictChainComparison(strictChainComparison);
+
+	/* Ask the backend not to convert the decoded frames to BGR. */
+	if (NV12Input)
+		capturedVideo.set(CV_CAP_PROP_CONVERT_RGB, 0);
+
+	/* Debug data. */
+	double totalTime = 0;
+	double avgIterations = 0;
+	double avgAgreement = 0;
+	double avgEnergyRatio = 0;
+
+	boost::chrono::high_resolution_clock::time_point startPoint =
+		boost::chrono::high_resolution_clock::now();
+
+	const unsigned framesNumber = SLICFrames.createSuperpixels(
+		[&](Mat& frame)
+		{
+			return ReadVideoFrame(capturedVideo, frame, videoHeight, NV12Input);
+		},
+		[&](unsigned frameIndex, const SLIC& frameSLIC, const Mat&, double elapsedTime,
+			const WavefrontFrameQuality* quality)
+		{
+			totalTime += elapsedTime;
+			avgIterations += frameSLIC.iterationIndex;
+
+			cout << "Frame: " << frameIndex + 1
+				<< "   ex. time now: " << elapsedTime
+				<< "   average ex. time: " << totalTime / (frameIndex + 1)
+				<< "   numOfCentres: " << frameSLIC.clustersNumber
+				<< "   numOfIterations: " << frameSLIC.iterationIndex
+				<< "   average iterations: " << avgIterations / (frameIndex + 1);
+
+			/* Difference with the strict chain. */
+			if (quality != NULL)
+			{
+				avgAgreement += quality->labelsAgreement;
+				avgEnergyRatio += (quality->strictChainEnergy > 0) ? quality->energy / quality->strictChainEnergy : 1;
+
+				cout << "   labels as strict chain: " << quality->labelsAgreement
+					<< "   energy: " << quality->energy
+					<< " instead of " << quality->strictChainEnergy;
+			}
+
+			cout << endl << endl;
+		},
+		stepSLIC, spatialDistanceWeight, iterationNumber, errorThreshold,
+		SLICMode, videoMode, keyFramesRatio, GaussianStdDev);
+
+	boost::chrono::high_resolution_clock::time_point endPoint =
+		boost::chrono::high_resolution_clock::now();
+
+	const double wallTime = boost::chrono::duration<double>(endPoint - startPoint).count();
+
+	cout << "Frames: " << framesNumber
+		<< "   lag: " << lagIterations
+		<< "   frames per second: " << ((wallTime > 0) ? framesNumber / wallTime : 0);
+
+	if (strictChainComparison && framesNumber != 0)
+		cout << "   average labels as strict chain: " << avgAgreement / framesNumber
+			<< "   average energy ratio: " << avgEnergyRatio / framesNumber;
+
+	cout << endl;
+
+	cin.ignore();
+
+	return 0;
+}
+
+bool ReadVideoFrame(
+	VideoCapture&  capturedVideo,
+	Mat&           frame,
+	unsigned       videoHeight,
+	bool&          NV12Input
+	)
+{
+	capturedVideo >> frame;
+
+	if (frame.data == NULL)
+		return false;
+
+	/* An NV12 frame is a single-channel matrix holding the Y rows
+	   followed by half as many rows (rounded up) of interleaved U, V
+	   samples. */
+	if (NV12Input && (frame.type() != CV_8UC1 ||
+		frame.rows != static_cast<int>(videoHeight + (videoHeight + 1) / 2)))
+	{
+		/* The backend does not give NV12 frames: let it convert them to
+		   BGR again, and skip this raw frame if it cannot be converted. */
+		NV12Input = false;
+		capturedVideo.set(CV_CAP_PROP_CONVERT_RGB, 1);
+
+		if (frame.channels() != 3)
+		{
+			capturedVideo >> frame;
+
+			if (frame.data == NULL)
+				return false;
+		}
+	}
+
+	return true;
+}
+
+int BenchmarkSLIC(
+	VideoCapture&  capturedVideo,
+	unsigned       spatialDistanceWeight,
+	unsigned       iterationNumber,
+	unsigned       benchmarkWidth,
+	unsigned       benchmarkHeight,
+	unsigned       repetitions
+	)
+{
+	Mat frame;
+
+	capturedVideo >> frame;
+
+	if (frame.data == NULL)
+	{
+		cout << "\nSorry, the video has no frames.\n";
+		return -1;
+	}
+
+	resize(frame, frame, Size(benchmarkWidth, benchmarkHeight), 0, 0, INTER_LINEAR);
+	cvtColor(frame, frame, CV_BGR2Lab);
+
+	/* The same workspace for all the runs, as for a video. */
+	SLIC SLICFrame;
+
+	const unsigned superpixelNumbers[] = {
+		100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000 };
+
+	unsigned previousStep = 0;
+
+	for (const unsigned superpixelNumber : superpixelNumbers)
+	{
+		const unsigned stepSLIC = std::max(static_cast<unsigned>(
+			sqrt((benchmarkHeight * benchmarkWidth) / superpixelNumber) + 0.5), 1u);
+
+		/* Superpixel numbers giving the same step give the same run. */
+		if (stepSLIC == previousStep)
+			continue;
+
+		previousStep = stepSLIC;
+
+		double bestTime = DBL_MAX;
+
+		for (unsigned repetition = 0; repetition < repetitions; ++repetition)
+		{
+			boost::chrono::high_resolution_clock::time_point startPoint =
+				boost::chrono::high_resolution_clock::now();
+
+			SLICFrame.createSuperpixels(
+				frame, stepSLIC, spatialDistanceWeight, iterationNumber, 0,
+				FIXED_ITERATIONS, NOISE, 1, 0, false);
+
+			boost::chrono::high_resolution_clock::time_point endPoint =
+				boost::chrono::high_resolution_clock::now();
+
+			bestTime = std::min(bestTime,
+				boost::chrono::duration<double, boost::milli>(endPoint - startPoint).count());
+		}
+
+		cout << "Superpixels: " << superpixelNumber
+			<< "   step: " << stepSLIC
+			<< "   numOfCentres: " << SLICFrame.clustersNumber
+			<< "   ex. time: " << bestTime
+			<< "   per iteration: " << bestTime / std::max(SLICFrame.iterationIndex, 1u)
+			<< "   per centre and iteration (ns): "
+			<< 1e6 * bestTime / std::max(SLICFrame.iterationIndex, 1u) / std::max(SLICFrame.clustersNumber, 1u)
+			<< endl;
+	}
+
+	/* Best time of a few elaborations of the frame with a given step. */
+	auto timeElaboration = [&](SLIC& SLICWorkspace, const unsigned stepSLIC)
+	{
+		double bestTime = DBL_MAX;
+
+		for (unsigned repetition = 0; repetition < repetitions; ++repetition)
+		{
+			boost::chrono::high_resolution_clock::time_point startPoint =
+				boost::chrono::high_resolution_clock::now();
+
+			SLICWorkspace.createSuperpixels(
+				frame, stepSLIC, spatialDistanceWeight, iterationNumber, 0,
+				FIXED_ITERATIONS, NOISE, 1, 0, false);
+
+			boost::chrono::high_resolution_clock::time_point endPoint =
+				boost::chrono::high_resolution_clock::now();
+
+			bestTime = std::min(bestTime,
+				boost::chrono::duration<double, boost::milli>(endPoint - startPoint).count());
+		}
+
+		return bestTime;
+	};
+
+	/* The comparisons run at 10000 superpixels. */
+	const unsigned comparisonStep = std::max(static_cast<unsigned>(
+		sqrt((benchmarkHeight * benchmarkWidth) / 10000) + 0.5), 1u);
+
+	/* Fixed-point against double precision iterations: the speed-up of the
+	   whole elaboration and, in instrumented builds, of the assignment
+	   kernel (the target is 2x), and the share of pixels given the same
+	   label (at least 99%). */
+	const SLICArithmetic arithmetics[] = { FLOATING_POINT, FIXED_POINT };
+	double               arithmeticTimes[] = { 0, 0 };
+	double               assignmentTimes[] = { 0, 0 };
+	std::vector<int>     arithmeticLabels[2];
+
+	for (int arithmetic = 0; arithmetic < 2; ++arithmetic)
+	{
+		SLIC arithmeticFrame;
+		arithmeticFrame.setArithmetic(arithmetics[arithmetic]);
+
+		arithmeticTimes[arithmetic] = timeElaboration(arithmeticFrame, comparisonStep);
+		arithmeticLabels[arithmetic] = arithmeticFrame.getPixelClusters();
+
+#ifdef SLIC_INSTRUMENTATION
+		assignmentTimes[arithmetic] = arithmeticFrame.getInstrumentation().getFrames().back().phaseTicks[PHASE_ASSIGNMENT] *
+			SLICInstrumentation::getNanosecondsPerTick() / 1e6;
+#endif
+	}
+
+	size_t sameLabels = 0;
+
+	for (size_t n = 0; n < arithmeticLabels[0].size(); ++n)
+		sameLabels += (arithmeticLabels[0][n] == arithmeticLabels[1][n]);
+
+	const double labelsAgreement = static_cast<double>(sameLabels) / std::max(arithmeticLabels[0].size(), static_cast<size_t>(1));
+
+	cout << "Fixed point   step: " << comparisonStep
+		<< "   ex. time: " << arithmeticTimes[1] << " instead of " << arithmeticTimes[0]
+		<< "   speed-up: " << arithmeticTimes[0] / arithmeticTimes[1];
+
+	if (assignmentTimes[0] != 0 && assignmentTimes[1] != 0)
+		cout << "   assignment speed-up: " << assignmentTimes[0] / assignmentTimes[1] << " (target 2)";
+
+	cout << "   same labels: " << 100 * labelsAgreement << "%"
+		<< ((labelsAgreement >= 0.99) ? " (within tolerance)" : " (beyond the 1% tolerance)") << endl;
+
+	/* The checks below only depend on the frame, so every run of the
+	   benchmark repeats them: the benchmark fails if the fixed-point labels
+	   are beyond the tolerance, if CHECKERBOARD and PIXEL_CENTRIC do not
+	   give the labels of the clusters assigned one after the other, or if
+	   the Morton relabelling does more than permute the labels. */
+	bool selfCheckPassed = (labelsAgreement >= 0.99);
+
+	const AssignmentSchedule checkedSchedules[] = { CLUSTER_PARALLEL, CHECKERBOARD, PIXEL_CENTRIC };
+	const char* const        checkedScheduleNames[] = { "serial", "checkerboard", "pixel centric" };
+	std::vector<int>         serialLabels;
+
+	for (int schedule = 0; schedule < 3; ++schedule)
+	{
+		SLIC scheduleFrame;
+		scheduleFrame.setAssignmentSchedule(checkedSchedules[schedule]);
+
+		/* CLUSTER_PARALLEL on a single thread is the reference order. */
+		tbb::task_arena scheduleArena((schedule == 0) ? 1 : tbb::task_arena::automatic);
+
+		scheduleArena.execute([&]
+		{
+			scheduleFrame.createSuperpixels(
+				frame, comparisonStep, spatialDistanceWeight, iterationNumber, 0,
+				FIXED_ITERATIONS, NAIVE, 1, 0, false);
+		});
+
+		if (schedule == 0)
+		{
+			serialLabels = scheduleFrame.getPixelClusters();
+			continue;
+		}
+
+		const bool sameScheduleLabels = (scheduleFrame.getPixelClusters() == serialLabels);
+
+		cout << "Schedule: " << checkedScheduleNames[schedule]
+			<< "   step: " << comparisonStep
+			<< "   same labels as " << checkedScheduleNames[0] << ": " << (sameScheduleLabels ? "yes" : "no") << endl;
+
+		selfCheckPassed = selfCheckPassed && sameScheduleLabels;
+	}
+
+	/* A few connected frames relabelled at every frame, against the same
+	   frames never relabelled: relabelledIndexes maps the clusters of the
+	   latter to those of the former through every permutation so far. */
+	SLIC relabelledFrame, referenceFrame;
+	relabelledFrame.setRelabellingPeriod(1);
+
+	std::vector<unsigned> relabelledIndexes;
+	bool                  permutedLabels = true;
+
+	for (unsigned frameIndex = 0; frameIndex < 3 && permutedLabels; ++frameIndex)
+	{
+		referenceFrame.createSuperpixels(
+			frame, comparisonStep, spatialDistanceWeight, iterationNumber, 0,
+			FIXED_ITERATIONS, NAIVE, 1, 0, true);
+		relabelledFrame.createSuperpixels(
+			frame, comparisonStep, spatialDistanceWeight, iterationNumber, 0,
+			FIXED_ITERATIONS, NAIVE, 1, 0, true);
+
+		if (referenceFrame.clustersNumber != relabelledFrame.clustersNumber)
+		{
+			permutedLabels = false;
+			break;
+		}
+
+		if (frameIndex == 0)
+		{
+			relabelledIndexes.resize(referenceFrame.clustersNumber);
+
+			for (unsigned k = 0; k < referenceFrame.clustersNumber; ++k)
+				relabelledIndexes[k] = k;
+		}
+
+		const std::vector<unsigned>& permutation = relabelledFrame.getLastClusterPermutation();
+
+		if (permutation.empty() == false)
+			for (unsigned& index : relabelledIndexes)
+				index = permutation[index];
+
+		const std::vector<int>& referenceLabels = referenceFrame.getPixelClusters();
+		const std::vector<int>& relabelledLabels = relabelledFrame.getPixelClusters();
+
+		for (size_t n = 0; n < referenceLabels.size() && permutedLabels; ++n)
+			permutedLabels = (referenceLabels[n] == -1) ? (relabelledLabels[n] == -1) :
+				(relabelledLabels[n] == static_cast<int>(relabelledIndexes[referenceLabels[n]]));
+	}
+
+	cout << "Morton relabelling   step: " << comparisonStep
+		<< "   labels only permuted: " << (permutedLabels ? "yes" : "no") << endl;
+
+	selfCheckPassed = selfCheckPassed && permutedLabels;
+
+	/* Memory traffic of the assignment with the clusters in index order and
+	   with the bands swept: the model of the bytes
+	   touched and, when hardware counters are read, the bytes actually
+	   loaded from memory (last level cache misses of 64 bytes). */
+	const AssignmentSchedule schedules[] = { CLUSTER_PARALLEL, BAND_SWEEP };
+	const char* const        scheduleNames[] = { "cluster parallel", "band sweep" };
+	double                   assignmentBytes[] = { 0, 0 };
+
+	for (int schedule = 0; schedule < 2; ++schedule)
+	{
+		SLIC scheduleFrame;
+		scheduleFrame.setAssignmentSchedule(schedules[schedule]);
+
+		const double bestTime = timeElaboration(scheduleFrame, comparisonStep);
+
+		cout << "Schedule: " << scheduleNames[schedule]
+			<< "   step: " << comparisonStep
+			<< "   ex. time: " << bestTime;
+
+		const BandSweepStatistics& bandSweep = scheduleFrame.getBandSweepStatistics();
+
+		if (bandSweep.bandsNumber != 0)
+			cout << "   traffic model per iteration (MB): " << bandSweep.sweepBytes / 1048576.0
+				<< " instead of " << bandSweep.searchRegionsBytes / 1048576.0;
+
+#ifdef SLIC_INSTRUMENTATION
+		const SLICFrameRecord& frameRecord = scheduleFrame.getInstrumentation().getFrames().back();
+
+		if (frameRecord.phaseCounters[PHASE_ASSIGNMENT][PERF_CYCLES] != 0)
+		{
+			assignmentBytes[schedule] = 64.0 * frameRecord.phaseCounters[PHASE_ASSIGNMENT][PERF_LLC_MISSES] /
+				std::max(scheduleFrame.iterationIndex, 1u);
+
+			cout << "   measured traffic per iteration (MB): " << assignmentBytes[schedule] / 1048576.0;
+		}
+#endif
+
+		cout << endl;
+	}
+
+	if (assignmentBytes[0] != 0 && assignmentBytes[1] != 0)
+		cout << "Band sweep memory traffic reduction: " << assignmentBytes[0] / assignmentBytes[1] << "x" << endl;
+
+	cout << "Self-check: " << (selfCheckPassed ? "PASS" : "FAIL") << endl;
+
+	cin.ignore();
+
+	return (selfCheckPassed) ? 0 : -1;
+}
+
+int TiledImageSLIC(
+	const string&  imageLocation,
+	unsigned       imageWidth,
+	unsigned       imageHeight,
+	const string&  labelsLocation,
+	unsigned       tileSize,
+	unsigned       superpixelNumber,
+	unsigned       spatialDistanceWeight,
+	unsigned       iterationNumber,
+	bool           seamComparison
+	)
+{
+	/* TIFF images are recognized by their extension. */
+	const size_t extension = imageLocation.find_last_of('.');
+	const bool   TIFFImage = (extension != string::npos) &&
+		(imageLocation.substr(extension) == ".tif" || imageLocation.substr(extension) == ".tiff");
+
+	if (TIFFImage && TiledSLIC::getTIFFSize(imageLocation, imageWidth, imageHeight) == false)
+	{
+		cout << "\nSorry, only 8-bit RGB TIFF images in uncompressed strips can be elaborated.\n";
+		return -1;
+	}
+
+	/* The same step as for a video frame of this size. */
+	const unsigned stepSLIC = std::max(static_cast<unsigned>(
+		sqrt((static_cast<double>(imageHeight) * imageWidth) / superpixelNumber) + 0.5), 1u);
+
+	TiledSLIC tiledSLIC(tileSize, stepSLIC, spatialDistanceWeight, iterationNumber);
+
+	boost::chrono::high_resolution_clock::time_point startPoint =
+		boost::chrono::high_resolution_clock::now();
+
+	const int superpixels = (TIFFImage) ?
+		tiledSLIC.createSuperpixelsFromTIFF(imageLocation, labelsLocation) :
+		tiledSLIC.createSuperpixels(imageLocation, imageWidth, imageHeight, labelsLocation, RAW_BGR);
+
+	boost::chrono::high_resolution_clock::time_point endPoint =
+		boost::chrono::high_resolution_clock::now();
+
+	if (superpixels == -1)
+	{
+		cout << "\nSorry, there was an error with the image or the labels file.\n";
+		return -1;
+	}
+
+	cout << "Tiled superpixels: " << superpixels
+		<< "   step: " << stepSLIC
+		<< "   ex. time: " << boost::chrono::duration<double, boost::milli>(endPoint - startPoint).count()
+		<< endl;
+
+	if (seamComparison)
+	{
+		double seamAgreement, otherAgreement;
+
+		const bool compared = (TIFFImage) ?
+			tiledSLIC.compareTIFFWithWholeImage(imageLocation, labelsLocation, seamAgreement, otherAgreement) :
+			tiledSLIC.compareWithWholeImage(imageLocation, imageWidth, imageHeight, labelsLocation,
+				seamAgreement, otherAgreement, RAW_BGR);
+
+		if (compared == false)
+		{
+			cout << "\nSorry, the image could not be elaborated as a whole.\n";
+			return -1;
+		}
+
+		/* Pairs of neighbouring pixels in the same superpixel, or in
+		   different ones, in both the tiled and the whole image. */
+		cout << "Agreement with the whole image across the seams: " << 100 * seamAgreement
+			<< "%   elsewhere: " << 100 * otherAgreement << "%" << endl;
+	}
+
+	return 0;
+}
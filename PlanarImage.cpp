@@ -0,0 +1,164 @@
+/****************************************************************************/
+/*                                                                          */
+/* Filename:       PlanarImage.cpp                                          */
+/*                                                                          */
+/* File base:      PlanarImage                                              */
+/* File extension: cpp                                                      */
+/*                                                                          */
+/* Purpose:        view over the three 8-bit planes of a frame, given as    */
+/*                 raw pointers and strides, so that SLIC reads planar or   */
+/*                 interleaved buffers without copying them                 */
+/*                                                                          */
+/****************************************************************************/
+
+#include "PlanarImage.h"
+
+/****************************************************************************/
+/*                              Planar Image                                */
+/****************************************************************************/
+PlanarImage::PlanarImage()
+{
+	this->rows = 0;
+	this->cols = 0;
+
+	for (int channel = 0; channel < 3; ++channel)
+	{
+		this->planes[channel] = NULL;
+		this->pixelSteps[channel] = 0;
+		this->rowStrides[channel] = 0;
+		this->columnShifts[channel] = 0;
+		this->rowShifts[channel] = 0;
+	}
+}
+
+PlanarImage PlanarImage::fromMat(const cv::Mat& image)
+{
+	/* Other types would be read with the wrong element size. */
+	CV_Assert(image.type() == CV_8UC3);
+
+	PlanarImage view;
+
+	view.rows = image.rows;
+	view.cols = image.cols;
+
+	for (int channel = 0; channel < 3; ++channel)
+	{
+		view.planes[channel] = image.data + channel;
+		view.pixelSteps[channel] = 3;
+		view.rowStrides[channel] = image.step;
+	}
+
+	return view;
+}
+
+PlanarImage PlanarImage::fromPlanes(
+	const int    rows,
+	const int    cols,
+	const uchar* planeL,
+	const uchar* planeA,
+	const uchar* planeB,
+	const size_t rowStride)
+{
+	PlanarImage view;
+
+	view.rows = rows;
+	view.cols = cols;
+	view.planes[0] = planeL;
+	view.planes[1] = planeA;
+	view.planes[2] = planeB;
+
+	for (int channel = 0; channel < 3; ++channel)
+	{
+		view.pixelSteps[channel] = 1;
+		view.rowStrides[channel] = rowStride;
+	}
+
+	return view;
+}
+
+PlanarImage PlanarImage::fromNV12(
+	const int    rows,
+	const int    cols,
+	const uchar* planeY,
+	const uchar* planeUV,
+	const size_t strideY,
+	const size_t strideUV)
+{
+	PlanarImage view;
+
+	view.rows = rows;
+	view.cols = cols;
+	view.planes[0] = planeY;
+	view.planes[1] = planeUV;
+	view.planes[2] = planeUV + 1;
+
+	view.pixelSteps[0] = 1;
+	view.rowStrides[0] = strideY;
+
+	for (int channel = 1; channel < 3; ++channel)
+	{
+		view.pixelSteps[channel] = 2;
+		view.rowStrides[channel] = strideUV;
+		view.columnShifts[channel] = 1;
+		view.rowShifts[channel] = 1;
+	}
+
+	return view;
+}
+
+bool PlanarImage::isInterleaved() const
+{
+	for (int channel = 0; channel < 3; ++channel)
+		if (columnShifts[channel] != 0 || rowShifts[channel] != 0)
+			return false;
+
+	return pixelSteps[0] == 3 && pixelSteps[1] == 3 && pixelSteps[2] == 3 &&
+		planes[1] == planes[0] + 1 && planes[2] == planes[0] + 2 &&
+		rowStrides[1] == rowStrides[0] && rowStrides[2] == rowStrides[0];
+}
+
+void PlanarImage::copyTo(cv::Mat& image) const
+{
+	image.create(rows, cols, CV_8UC3);
+
+	for (int y = 0; y < rows; ++y)
+	{
+		uchar* destination = image.ptr<uchar>(y);
+
+		for (int x = 0; x < cols; ++x)
+			for (int channel = 0; channel < 3; ++channel)
+				destination[3 * x + channel] = value(channel, y, x);
+	}
+}
+
+void PlanarImage::downscale(
+	const int factor,
+	cv::Mat&  image) const
+{
+	const int downscaledRows = rows / factor;
+	const int downscaledCols = cols / factor;
+	const int blockPixels = factor * factor;
+
+	image.create(downscaledRows, downscaledCols, CV_8UC3);
+
+	for (int y = 0; y < downscaledRows; ++y)
+	{
+		uchar* destination = image.ptr<uchar>(y);
+
+		for (int x = 0; x < downscaledCols; ++x)
+			for (int channel = 0; channel < 3; ++channel)
+			{
+				int sum = 0;
+
+				for (int blockY = y * factor; blockY < (y + 1) * factor; ++blockY)
+				{
+					const uchar* source = row(channel, blockY);
+
+					for (int blockX = x * factor; blockX < (x + 1) * factor; ++blockX)
+						sum += source[column(channel, blockX)];
+				}
+
+				destination[3 * x + channel] = static_cast<uchar>((sum + blockPixels / 2) / blockPixels);
+			}
+	}
+}
@@ -0,0 +1,164 @@
+/****************************************************************************/
+/*                                                                          */
+/* Filename:       PlanarImage.h                                            */
+/*                                                                          */
+/* File base:      PlanarImage                                              */
+/* File extension: h                                                        */
+/*                                                                          */
+/* Purpose:        view over the three 8-bit planes of a frame, given as    */
+/*                 raw pointers and strides, so that SLIC reads planar or   */
+/*                 interleaved buffers without copying them                 */
+/*                                                                          */
+/****************************************************************************/
+
+#ifndef PLANARIMAGE_H
+#define PLANARIMAGE_H
+
+#include <opencv2/opencv.hpp>
+
+#include <cstddef>
+
+/* The samples of one row of a frame in each plane, so that the kernels
+   compute the row addresses once per row instead of once per pixel. */
+struct PlanarImageRow
+{
+	const uchar* planes[3];
+	int          pixelSteps[3];
+	int          columnShifts[3];
+
+	/* Value of a channel of the x-th pixel of the row. */
+	inline uchar value(
+		const int channel,
+		const int x) const
+	{
+		return planes[channel][(x >> columnShifts[channel]) * pixelSteps[channel]];
+	}
+
+	/* The three channels of the x-th pixel of the row. */
+	inline cv::Vec3b pixel(const int x) const
+	{
+		return cv::Vec3b(value(0, x), value(1, x), value(2, x));
+	}
+};
+
+/****************************************************************************/
+/*                              Planar Image                                */
+/****************************************************************************/
+struct PlanarImage
+{
+	/* Size of the frame in pixels. */
+	int rows;
+	int cols;
+
+	/* First byte of each plane (L, A, B). The view does not own them. */
+	const uchar* planes[3];
+
+	/* Bytes between two consecutive pixels of a row in each plane:
+	   1 for planar buffers, 3 for an interleaved cv::Mat. */
+	int pixelSteps[3];
+
+	/* Bytes between two consecutive rows of each plane. */
+	size_t rowStrides[3];
+
+	/* Subsampling of each plane as a power of two along the columns and
+	   the rows: 1 for the chroma planes of NV12, 0 otherwise. Subsampled
+	   planes are upsampled on the fly, by the nearest sample. */
+	int columnShifts[3];
+	int rowShifts[3];
+
+	PlanarImage();
+
+	/* View over an interleaved 8-bit, 3-channel cv::Mat (CV_8UC3). */
+	static PlanarImage fromMat(const cv::Mat& image);
+
+	/* View over three separate planes sharing the same row stride. */
+	static PlanarImage fromPlanes(
+		const int    rows,
+		const int    cols,
+		const uchar* planeL,
+		const uchar* planeA,
+		const uchar* planeB,
+		const size_t rowStride);
+
+	/* View over an NV12 frame as decoded: a full resolution Y plane and a
+	   plane of interleaved U, V samples at half resolution. The clusters
+	   are computed in YUV, with no conversion to Lab. */
+	static PlanarImage fromNV12(
+		const int    rows,
+		const int    cols,
+		const uchar* planeY,
+		const uchar* planeUV,
+		const size_t strideY,
+		const size_t strideUV);
+
+	/* First byte of the plane's row holding the samples of the y-th row
+	   of the frame. */
+	inline const uchar* row(
+		const int channel,
+		const int y) const
+	{
+		return planes[channel] + (y >> rowShifts[channel]) * rowStrides[channel];
+	}
+
+	/* Offset from row(channel, y) of the sample of the x-th column. */
+	inline int column(
+		const int channel,
+		const int x) const
+	{
+		return (x >> columnShifts[channel]) * pixelSteps[channel];
+	}
+
+	/* The samples of the y-th row of the frame, for loops over its pixels. */
+	inline PlanarImageRow pixelRow(const int y) const
+	{
+		PlanarImageRow samples;
+
+		for (int channel = 0; channel < 3; ++channel)
+		{
+			samples.planes[channel] = row(channel, y);
+			samples.pixelSteps[channel] = pixelSteps[channel];
+			samples.columnShifts[channel] = columnShifts[channel];
+		}
+
+		return samples;
+	}
+
+	/* Value of a channel of the pixel (x, y), for scattered accesses. */
+	inline uchar value(
+		const int channel,
+		const int y,
+		const int x) const
+	{
+		return row(channel, y)[column(channel, x)];
+	}
+
+	/* The three channels of the pixel (x, y). */
+	inline cv::Vec3b pixel(
+		const int y,
+		const int x) const
+	{
+		return cv::Vec3b(value(0, y, x), value(1, y, x), value(2, y, x));
+	}
+
+	/* Bytes of a pixel over the three planes. */
+	inline size_t elemSize() const
+	{
+		return 3;
+	}
+
+	/* True when the planes are the interleaved channels of one buffer, at
+	   full resolution, so
+	   that a row of the frame is 3 x cols contiguous bytes from row(0, y). */
+	bool isInterleaved() const;
+
+	/* Copy the frame into an interleaved 8-bit, 3-channel cv::Mat. */
+	void copyTo(cv::Mat& image) const;
+
+	/* Average the pixels of each factor x factor block into an interleaved
+	   cv::Mat (as cv::resize with INTER_AREA for integer factors). */
+	void downscale(
+		const int factor,
+		cv::Mat&  image) const;
+};
+
+#endif
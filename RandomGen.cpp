@@ -15,6 +15,11 @@
 
 #include "RandomGen.h"
 
+/* Intel Threading Building Blocks libraries. */
+#include <tbb/tbb.h>
+
+#include <cmath>
+
 /****************************************************************************/
 /*                      Normal (Gaussian) Distribution                      */
 /****************************************************************************/
@@ -43,4 +48,73 @@ double RandNormal::GetVariance()
 double RandNormal::operator()()
 {
 	return m_normal_gen();
+}
+
+/****************************************************************************/
+/*                  Batched Normal (Gaussian) Distribution                  */
+/****************************************************************************/
+BatchNormal::BatchNormal(unsigned long long seed)
+{
+	m_seed = seed;
+}
+
+unsigned long long BatchNormal::GetSeed()
+{
+	return m_seed;
+}
+
+void BatchNormal::SetSeed(unsigned long long seed)
+{
+	m_seed = seed;
+}
+
+unsigned long long BatchNormal::Mix(unsigned long long value)
+{
+	value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+	value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+	return value ^ (value >> 31);
+}
+
+void BatchNormal::Fill(
+	double*            values,
+	size_t             count,
+	double             mean,
+	double             stddev,
+	unsigned long long stream)
+{
+	/* Each stream has its own key, so that the counters of different
+	   streams never meet. */
+	const unsigned long long key = Mix(m_seed ^ Mix(stream + 0x9e3779b97f4a7c15ULL));
+	const double             unit = 1.0 / 9007199254740992.0;
+	const double             twoPi = 6.283185307179586;
+
+	/* 53 random bits per uniform number; the first one is in (0, 1], so
+	   that its logarithm is finite. */
+	auto radius = [=](size_t pair)
+	{
+		return stddev * std::sqrt(-2.0 * std::log(((Mix(key + 2 * pair) >> 11) + 1) * unit));
+	};
+	auto angle = [=](size_t pair)
+	{
+		return twoPi * ((Mix(key + 2 * pair + 1) >> 11) * unit);
+	};
+
+	/* The pairs are independent: blocks of them are filled in parallel,
+	   and the loop over a block has no branch nor carried state, so it can
+	   be vectorized. */
+	tbb::parallel_for(tbb::blocked_range<size_t>(0, count / 2, 4096), [=](const tbb::blocked_range<size_t>& range)
+	{
+		for (size_t pair = range.begin(); pair != range.end(); ++pair)
+		{
+			const double pairRadius = radius(pair);
+			const double pairAngle = angle(pair);
+
+			values[2 * pair] = mean + pairRadius * std::cos(pairAngle);
+			values[2 * pair + 1] = mean + pairRadius * std::sin(pairAngle);
+		}
+	});
+
+	/* An odd count uses half of the last pair. */
+	if (count % 2 != 0)
+		values[count - 1] = mean + radius(count / 2) * std::cos(angle(count / 2));
 }
\ No newline at end of file
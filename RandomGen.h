@@ -52,6 +52,42 @@ class RandNormal
 		double operator()();
 };
 
+/****************************************************************************/
+/*                  Batched Normal (Gaussian) Distribution                  */
+/****************************************************************************/
+/* Counter-based generator: the n-th value of a stream only depends on the
+   seed, on the stream and on n, so a whole array is filled in one call
+   with no state carried from one value to the next, and the same seed
+   always gives the same values. */
+class BatchNormal
+{
+	private:
+
+		unsigned long long m_seed;
+
+		/* SplitMix64 finalizer: a bijective, well mixed hash of a counter. */
+		static unsigned long long Mix(unsigned long long value);
+
+	public:
+
+		BatchNormal(unsigned long long seed = 0);
+
+		unsigned long long GetSeed();
+
+		void SetSeed(unsigned long long seed);
+
+		/* Fill values[0], ..., values[count - 1] with the first count
+		   values of the given stream, with the given mean and standard
+		   deviation (Box-Muller transform, two values per pair of
+		   uniform numbers). */
+		void Fill(
+			double*            values,
+			size_t             count,
+			double             mean,
+			double             stddev,
+			unsigned long long stream);
+};
+
 #endif
 
 
@@ -20,6 +20,57 @@ SLIC::SLIC()
 	this->pixelCluster.clear();
 	this->distanceFromClusterCentre.clear();
 	this->pixelReachedByClusters.clear();
+
+	/* Identity 0 is never given to a superpixel. */
+	this->totalFramesNumber = 0;
+	this->nextClusterIdentifier = 1;
+	this->identityMatchingPending = false;
+	this->identityOverlapThreshold = 0.25;
+	this->identityTracking = false;
+
+	/* Default background model for STATIC_CAMERA mode. */
+	this->tileSize = 16;
+	this->tilesPerRow = 0;
+	this->tilesPerColumn = 0;
+	this->backgroundChangeThreshold = 6.0;
+	this->backgroundLearningRate = 0.05;
+	this->backgroundFrozen = false;
+	this->tileContributionsValid = false;
+
+	/* Default quality of KEY_FRAMES_PROPAGATION mode. */
+	this->lastFramePath = FULL_ITERATIONS;
+	this->propagationRefinements = 2;
+	this->motionSearchRange = 16;
+
+	/* The pyramid is disabled by default. */
+	this->pyramidLevels = 0;
+	this->pyramidCoarseIterations = 8;
+	this->pyramidFinalIterations = 2;
+	this->centresSeededFromPyramid = false;
+	this->seedCentresContinueChain = false;
+
+	/* Every pixel is evaluated by default. */
+	this->subsampledIterations = 0;
+	this->samplingLevel = 0;
+	this->samplingOffset = 0;
+
+	this->arithmetic = FLOATING_POINT;
+
+	this->pixelStateLayout = SEPARATE_ARRAYS;
+	this->packedPixelStateSize = 0;
+
+	this->assignmentSchedule = CLUSTER_PARALLEL;
+
+	this->bandSweepStatistics = BandSweepStatistics();
+
+	/* Clusters keep their indexes by default. */
+	this->relabellingPeriod = 0;
+
+	/* Search regions are split when there are few clusters. */
+	this->rowSplitting = 0;
+	this->lastRowSplits = 1;
+
+	this->noiseGenerator.SetSeed(0);
 }
 
 SLIC::SLIC(const SLIC& otherSLIC)
@@ -45,10 +96,84 @@ SLIC::SLIC(const SLIC& otherSLIC)
 	this->totalResidualError = otherSLIC.totalResidualError;
 	this->errorThreshold = otherSLIC.errorThreshold;
 	this->framesNumber = otherSLIC.framesNumber;
+	this->totalFramesNumber = otherSLIC.totalFramesNumber;
+	this->nextClusterIdentifier = otherSLIC.nextClusterIdentifier;
+	this->identityMatchingPending = otherSLIC.identityMatchingPending;
+	this->identityOverlapThreshold = otherSLIC.identityOverlapThreshold;
+	this->identityTracking = otherSLIC.identityTracking;
+
+	/* Copy superpixel identities. */
+	this->clusterIdentifiers = otherSLIC.clusterIdentifiers;
+	this->previousPixelCluster = otherSLIC.previousPixelCluster;
+	this->previousClusterIdentifiers = otherSLIC.previousClusterIdentifiers;
+	this->previousIdentityCentres = otherSLIC.previousIdentityCentres;
+	this->superpixelEvents = otherSLIC.superpixelEvents;
+
+	/* Copy the static camera background model. */
+	this->tileSize = otherSLIC.tileSize;
+	this->tilesPerRow = otherSLIC.tilesPerRow;
+	this->tilesPerColumn = otherSLIC.tilesPerColumn;
+	this->backgroundChangeThreshold = otherSLIC.backgroundChangeThreshold;
+	this->backgroundLearningRate = otherSLIC.backgroundLearningRate;
+	this->backgroundModel = otherSLIC.backgroundModel;
+	this->changedTiles = otherSLIC.changedTiles;
+	this->changedTilesIntegral = otherSLIC.changedTilesIntegral;
+	this->activeClusters = otherSLIC.activeClusters;
+	this->clusterIsActive = otherSLIC.clusterIsActive;
+	this->backgroundFrozen = otherSLIC.backgroundFrozen;
+	this->tileHashes = otherSLIC.tileHashes;
+	this->tileContributions = otherSLIC.tileContributions;
+	this->tileContributionsStale = otherSLIC.tileContributionsStale;
+	this->tileContributionsValid = otherSLIC.tileContributionsValid;
+
+	/* Copy labels propagation data. */
+	this->lastFramePath = otherSLIC.lastFramePath;
+	this->propagationRefinements = otherSLIC.propagationRefinements;
+	this->motionSearchRange = otherSLIC.motionSearchRange;
+	this->previousColumnProfile = otherSLIC.previousColumnProfile;
+	this->previousRowProfile = otherSLIC.previousRowProfile;
+
+	/* Copy pyramid parameters. */
+	this->pyramidLevels = otherSLIC.pyramidLevels;
+	this->pyramidCoarseIterations = otherSLIC.pyramidCoarseIterations;
+	this->pyramidFinalIterations = otherSLIC.pyramidFinalIterations;
+	this->centresSeededFromPyramid = otherSLIC.centresSeededFromPyramid;
+	this->seedCentres = otherSLIC.seedCentres;
+	this->seedCentresContinueChain = otherSLIC.seedCentresContinueChain;
+	this->iterationCallback = otherSLIC.iterationCallback;
+#ifdef SLIC_INSTRUMENTATION
+	this->instrumentation = otherSLIC.instrumentation;
+#endif
+	this->noiseGenerator = otherSLIC.noiseGenerator;
+	this->subsampledIterations = otherSLIC.subsampledIterations;
+	this->samplingLevel = otherSLIC.samplingLevel;
+	this->samplingOffset = otherSLIC.samplingOffset;
+
+	/* Copy fixed point data. */
+	this->arithmetic = otherSLIC.arithmetic;
+	this->fixedCentreColors = otherSLIC.fixedCentreColors;
+	this->fixedCentrePositions = otherSLIC.fixedCentrePositions;
+	this->fixedDistanceFromClusterCentre = otherSLIC.fixedDistanceFromClusterCentre;
+	this->fixedClusterSums = otherSLIC.fixedClusterSums;
+	this->spatialDistanceTable = otherSLIC.spatialDistanceTable;
+
+	/* Packed words are rebuilt at every iteration. */
+	this->pixelStateLayout = otherSLIC.pixelStateLayout;
+	this->packedPixelStateSize = 0;
+
+	/* The centres grid is rebuilt at every iteration. */
+	this->assignmentSchedule = otherSLIC.assignmentSchedule;
+
+	this->bandSweepStatistics = otherSLIC.bandSweepStatistics;
+	this->relabellingPeriod = otherSLIC.relabellingPeriod;
+	this->lastClusterPermutation = otherSLIC.lastClusterPermutation;
+	this->rowSplitting = otherSLIC.rowSplitting;
+	this->lastRowSplits = otherSLIC.lastRowSplits;
 
 	/* Copy matrices. */
 	this->pixelCluster.resize(otherSLIC.pixelsNumber);
-	this->distanceFromClusterCentre.resize(otherSLIC.pixelsNumber);
+	this->pixelReachedByClusters = otherSLIC.pixelReachedByClusters;
+	this->distanceFromClusterCentre = otherSLIC.distanceFromClusterCentre;
 	this->clusterCentres.resize(otherSLIC.clusterCentres.size());
 	this->previousClusterCentres.resize(otherSLIC.previousClusterCentres.size());
 	this->pixelsOfSameCluster.resize(otherSLIC.pixelsOfSameCluster.size());
@@ -57,8 +182,6 @@ SLIC::SLIC(const SLIC& otherSLIC)
 	for (unsigned n = 0; n < otherSLIC.pixelsNumber; ++n)
 	{
 		this->pixelCluster[n] = otherSLIC.pixelCluster[n];
-		this->pixelReachedByClusters[n] = otherSLIC.pixelReachedByClusters[n];
-		this->distanceFromClusterCentre[n] = otherSLIC.distanceFromClusterCentre[n];
 	}
 
 	for (unsigned n = 0; n < otherSLIC.clustersNumber; ++n)
@@ -115,8 +238,8 @@ void SLIC::clearSLICData()
 	this->residualError.clear();
 }
 
-void SLIC::initializeSLICData(
-	const cv::Mat&       image,
+bool SLIC::initializeSLICData(
+	const PlanarImage&   image,
 	const unsigned       samplingStep,
 	const unsigned       spatialDistanceWeight,
 	const double         errorThreshold,
@@ -125,17 +248,63 @@ void SLIC::initializeSLICData(
 	const double         GaussianStdDev,
 	const bool           connectedFrames)
 {
+	SLIC_PHASE_TIMER(instrumentation, PHASE_INITIALIZATION);
+
+	bool initializedFromScratch = false;
+
+	/* Centres of the previous frame of a chain elaborated elsewhere stand
+	for the centres of this object. */
+	const bool previousFrameSeeded = connectedFrames && seedCentresContinueChain && seedCentres.size() != 0;
+	const unsigned previousClustersNumber =
+		previousFrameSeeded ? static_cast<unsigned>(seedCentres.size() / 5) : clustersNumber;
+	seedCentresContinueChain = false;
+
+	/* Initialize data from scratch when using key frames. */
+	const bool keyFrame = ((videoMode == KEY_FRAMES) || (videoMode == KEY_FRAMES_NOISE))
+		&& (keyFramesRatio != 0) && (framesNumber % keyFramesRatio == 0);
+	const bool tooManyClusters = ((videoMode == ADD_SUPERPIXELS) || (videoMode == ADD_SUPERPIXELS_NOISE))
+		&& (previousClustersNumber > 1300);
+
+	/* The grid replaces the previous centres on these frames. */
+	if (previousFrameSeeded && (keyFrame || tooManyClusters))
+		seedCentres.clear();
+
+	const bool continuesSeededChain = previousFrameSeeded && seedCentres.size() != 0;
+	const unsigned chainFramesNumber = framesNumber;
+
 	/* If centres matrix from previous frame is empty,
 	or if frames must be processed independently,
 	initialize data from scratch. Otherwise, use
 	the data from previous frame as initialization.*/
-	if (connectedFrames == false || clusterCentres.size() == 0 ||
-		/* Initialize data from scratch when using key frames. */
-		(((videoMode == KEY_FRAMES) || (videoMode == KEY_FRAMES_NOISE))
-			&& (framesNumber % keyFramesRatio == 0)) ||
-		(((videoMode == ADD_SUPERPIXELS) || (videoMode == ADD_SUPERPIXELS_NOISE))
-			&& (clustersNumber > 1300)))
+	if (connectedFrames == false || clusterCentres.size() == 0 || seedCentres.size() != 0 ||
+		keyFrame || tooManyClusters)
 	{
+		initializedFromScratch = true;
+
+		/* Keep the superpixels of the last frame, so that their identities
+		can be matched with the new clusters at the end of this frame. */
+		if (clusterIdentifiers.size() > 0)
+		{
+			if (pixelCluster.size() == static_cast<size_t>(image.rows * image.cols))
+			{
+				previousPixelCluster.swap(pixelCluster);
+				previousClusterIdentifiers.swap(clusterIdentifiers);
+				previousIdentityCentres = clusterCentres;
+				identityMatchingPending = true;
+			}
+			else
+			{
+				/* Frame size changed: no overlap can be measured. */
+				for (unsigned n = 0; n < clusterIdentifiers.size(); ++n)
+				{
+					SuperpixelEvent death = { SUPERPIXEL_DEATH, clusterIdentifiers[n], totalFramesNumber,
+						clusterCentres[5 * n + 3], clusterCentres[5 * n + 4] };
+					superpixelEvents.push_back(death);
+				}
+			}
+			clusterIdentifiers.clear();
+		}
+
 		/* Clear previous data before initialization. */
 		if (clusterCentres.size() == 0) {
 			this->pixelCluster.clear();
@@ -144,166 +313,2032 @@ void SLIC::initializeSLICData(
 		}
 		clearSLICData();
 
-		/* Initialize debug data. */
-		this->minError = DBL_MAX;
-		this->minIterations = UINT_MAX;
-		this->minExecutionTime = UINT_MAX;
+		/* A chain continued from its previous frame keeps counting. */
+		if (continuesSeededChain)
+			this->framesNumber = chainFramesNumber;
+
+		/* Initialize debug data. */
+		this->minError = DBL_MAX;
+		this->minIterations = UINT_MAX;
+		this->minExecutionTime = UINT_MAX;
+
+		/* Initialize variables. */
+		this->pixelsNumber = image.rows * image.cols;
+		this->samplingStep = samplingStep;
+		this->spatialDistanceWeight = spatialDistanceWeight;
+		this->distanceFactor =
+			static_cast<double>(1.0 * spatialDistanceWeight * spatialDistanceWeight / (samplingStep * samplingStep));
+		this->errorThreshold = errorThreshold;
+
+		/* Initialize the clusters and the distances matrices. */
+		pixelCluster.assign(pixelsNumber, -1);
+		//pixelReachedByClusters.assign(pixelsNumber, 255);
+
+		/* The fixed-point and the packed iterations keep their own
+		distances: the double ones are only needed to freeze clusters. */
+		if ((arithmetic == FIXED_POINT || pixelStateLayout == PACKED_WORD) &&
+			videoMode != STATIC_CAMERA && videoMode != CONTENT_HASHING)
+			std::vector<double>().swap(distanceFromClusterCentre);
+		else
+			distanceFromClusterCentre.assign(pixelsNumber, DBL_MAX);
+
+		/* Start from the given centres, if any, or from the centres found
+		by SLIC on a downscaled frame, if the pyramid is enabled. */
+		centresSeededFromPyramid = false;
+
+		if (seedCentres.size() != 0)
+		{
+			clusterCentres.swap(seedCentres);
+			seedCentres.clear();
+			previousClusterCentres = clusterCentres;
+			pixelsOfSameCluster.assign(clusterCentres.size() / 5, 0);
+			residualError.assign(clusterCentres.size() / 5, 0);
+		}
+		else
+			centresSeededFromPyramid = seedCentresFromPyramid(image);
+
+		if (centresSeededFromPyramid == false && clusterCentres.size() == 0)
+		{
+			/* Initialize the centres matrix by sampling the image
+			at a regular step. */
+			for (int y = samplingStep; y < image.rows; y += samplingStep)
+				for (int x = samplingStep; x < image.cols; x += samplingStep)
+				{
+					/* Find the pixel with the lowest gradient in a 3x3 surrounding. */
+					Point lowestGradientPixel = findLowestGradient(image, Point(x, y));
+					Vec3b tempPixelColor = image.pixel(lowestGradientPixel.y, lowestGradientPixel.x);
+
+					/* Insert a [L, A, B, x, y] centre in the centres vector. */
+					clusterCentres.push_back(tempPixelColor.val[0]);
+					clusterCentres.push_back(tempPixelColor.val[1]);
+					clusterCentres.push_back(tempPixelColor.val[2]);
+					clusterCentres.push_back(lowestGradientPixel.x);
+					clusterCentres.push_back(lowestGradientPixel.y);
+
+					/* During initialization, previous cluster centres matrix
+					is the same as cluster centres matrix.*/
+					previousClusterCentres.push_back(tempPixelColor.val[0]);
+					previousClusterCentres.push_back(tempPixelColor.val[1]);
+					previousClusterCentres.push_back(tempPixelColor.val[2]);
+					previousClusterCentres.push_back(lowestGradientPixel.x);
+					previousClusterCentres.push_back(lowestGradientPixel.y);
+
+					/* Initialize "pixel of same cluster" matrix. */
+					pixelsOfSameCluster.push_back(0);
+
+					/* Initialize residual error to be zero for each cluster
+					centre. */
+					residualError.push_back(0);
+				}
+		}
+
+		/* Total number of clusters. */
+		this->clustersNumber = static_cast<unsigned>(pixelsOfSameCluster.size());
+
+		/* Give an identity to each new cluster. */
+		for (unsigned n = 0; n < clustersNumber; ++n)
+			addClusterIdentity(n);
+
+		///* Reset orphan pixels */
+		//if (videoMode == ADD_SUPERPIXELS || videoMode == ADD_SUPERPIXELS_NOISE)
+		//	orphanPixels = Mat(image.rows, image.cols, CV_8UC1, cv::Scalar(255));
+	}
+
+	/* Add Gaussian noise to the centres of the previous frame if requested. */
+	if ((initializedFromScratch == false || continuesSeededChain) &&
+		((videoMode == NOISE) || (videoMode == KEY_FRAMES_NOISE) || (videoMode == ADD_SUPERPIXELS_NOISE)))
+	{
+		/* Draw the displacements of all the centres at once. */
+		noiseDisplacements.resize(2 * clustersNumber);
+		noiseGenerator.Fill(noiseDisplacements.data(), noiseDisplacements.size(), 0.0, GaussianStdDev, totalFramesNumber);
+
+		/* Add some gaussian noise to position. */
+		/* Color should be kept equal: we look for a similar color in the surroundings. */
+		for (unsigned n = 0; n < clustersNumber; ++n)
+		{
+			clusterCentres[5 * n + 3] += noiseDisplacements[2 * n];
+			clusterCentres[5 * n + 4] += noiseDisplacements[2 * n + 1];
+		}
+	}
+
+	/* Initialize total residual error for each frame. */
+	this->totalResidualError = DBL_MAX;
+
+	/* Reset orphan pixels */
+	if (videoMode == ADD_SUPERPIXELS || videoMode == ADD_SUPERPIXELS_NOISE)
+		pixelReachedByClusters.assign(pixelsNumber, 255);
+
+	//if (videoMode == ADD_SUPERPIXELS || videoMode == ADD_SUPERPIXELS_NOISE)
+	////	orphanPixels = Mat(image.rows, image.cols, CV_8UC1, cv::Scalar(255));
+	//	orphanPixels.setTo(cv::Scalar(255));
+
+	return initializedFromScratch;
+}
+
+void SLIC::addClusterIdentity(const unsigned centreIndex)
+{
+	if (identityTracking == false)
+		return;
+
+	/* When identities are going to be matched at the end of the frame,
+	only reserve a place for this cluster. */
+	if (identityMatchingPending)
+	{
+		clusterIdentifiers.push_back(0);
+		return;
+	}
+
+	clusterIdentifiers.push_back(nextClusterIdentifier);
+
+	SuperpixelEvent birth = { SUPERPIXEL_BIRTH, nextClusterIdentifier, totalFramesNumber,
+		clusterCentres[5 * centreIndex + 3], clusterCentres[5 * centreIndex + 4] };
+	superpixelEvents.push_back(birth);
+
+	++nextClusterIdentifier;
+}
+
+void SLIC::matchClusterIdentities(const PlanarImage& image)
+{
+	const unsigned previousClustersNumber = static_cast<unsigned>(previousClusterIdentifiers.size());
+
+	std::vector<unsigned> currentSizes(clustersNumber, 0);
+	std::vector<unsigned> previousSizes(previousClustersNumber, 0);
+
+	/* Pixels shared by a new cluster c and an old superpixel o, stored
+	with key c * previousClustersNumber + o. Superpixels are compact, so
+	pixels are counted in runs along each row. */
+	std::unordered_map<unsigned long long, unsigned> overlaps;
+
+	for (int y = 0; y < image.rows; ++y)
+	{
+		int x = 0;
+
+		while (x < image.cols)
+		{
+			const int currentLabel = pixelCluster[y * image.cols + x];
+			const int previousLabel = previousPixelCluster[y * image.cols + x];
+
+			int runEnd = x + 1;
+			while (runEnd < image.cols &&
+				pixelCluster[y * image.cols + runEnd] == currentLabel &&
+				previousPixelCluster[y * image.cols + runEnd] == previousLabel)
+				++runEnd;
+
+			if (currentLabel >= 0)
+				currentSizes[currentLabel] += runEnd - x;
+			if (previousLabel >= 0)
+				previousSizes[previousLabel] += runEnd - x;
+			if (currentLabel >= 0 && previousLabel >= 0)
+				overlaps[static_cast<unsigned long long>(currentLabel) * previousClustersNumber + previousLabel] +=
+					runEnd - x;
+
+			x = runEnd;
+		}
+	}
+
+	/* Rank all the candidate pairs by intersection over union. */
+	std::vector<std::pair<double, unsigned long long>> candidates;
+	candidates.reserve(overlaps.size());
+
+	for (auto& overlap : overlaps)
+	{
+		const unsigned currentLabel = static_cast<unsigned>(overlap.first / previousClustersNumber);
+		const unsigned previousLabel = static_cast<unsigned>(overlap.first % previousClustersNumber);
+		const double intersectionOverUnion = static_cast<double>(overlap.second) /
+			(currentSizes[currentLabel] + previousSizes[previousLabel] - overlap.second);
+
+		if (intersectionOverUnion >= identityOverlapThreshold)
+			candidates.push_back(std::make_pair(intersectionOverUnion, overlap.first));
+	}
+
+	std::sort(candidates.begin(), candidates.end(),
+		[](const std::pair<double, unsigned long long>& a, const std::pair<double, unsigned long long>& b)
+		{ return a.first > b.first || (a.first == b.first && a.second < b.second); });
+
+	/* Greedily inherit the best overlapping identity, each one at most once. */
+	std::vector<bool> previousMatched(previousClustersNumber, false);
+
+	for (auto& candidate : candidates)
+	{
+		const unsigned currentLabel = static_cast<unsigned>(candidate.second / previousClustersNumber);
+		const unsigned previousLabel = static_cast<unsigned>(candidate.second % previousClustersNumber);
+
+		if (clusterIdentifiers[currentLabel] == 0 && previousMatched[previousLabel] == false)
+		{
+			clusterIdentifiers[currentLabel] = previousClusterIdentifiers[previousLabel];
+			previousMatched[previousLabel] = true;
+		}
+	}
+
+	/* Old superpixels without a match are gone. */
+	for (unsigned n = 0; n < previousClustersNumber; ++n)
+		if (previousMatched[n] == false)
+		{
+			SuperpixelEvent death = { SUPERPIXEL_DEATH, previousClusterIdentifiers[n], totalFramesNumber,
+				previousIdentityCentres[5 * n + 3], previousIdentityCentres[5 * n + 4] };
+			superpixelEvents.push_back(death);
+		}
+
+	/* New clusters without a match are new superpixels. */
+	for (unsigned n = 0; n < clustersNumber; ++n)
+		if (clusterIdentifiers[n] == 0)
+		{
+			clusterIdentifiers[n] = nextClusterIdentifier;
+
+			SuperpixelEvent birth = { SUPERPIXEL_BIRTH, nextClusterIdentifier, totalFramesNumber,
+				clusterCentres[5 * n + 3], clusterCentres[5 * n + 4] };
+			superpixelEvents.push_back(birth);
+
+			++nextClusterIdentifier;
+		}
+
+	identityMatchingPending = false;
+	previousPixelCluster.clear();
+	previousClusterIdentifiers.clear();
+	previousIdentityCentres.clear();
+}
+
+const std::vector<int>& SLIC::getPixelClusters() const
+{
+	return pixelCluster;
+}
+
+const std::vector<SuperpixelID>& SLIC::getSuperpixelIdentifiers() const
+{
+	return clusterIdentifiers;
+}
+
+const std::vector<SuperpixelEvent>& SLIC::getSuperpixelEvents() const
+{
+	return superpixelEvents;
+}
+
+void SLIC::clearSuperpixelEvents()
+{
+	superpixelEvents.clear();
+}
+
+void SLIC::setIdentityOverlapThreshold(const double threshold)
+{
+	identityOverlapThreshold = threshold;
+}
+
+void SLIC::setIdentityTracking(const bool enabled)
+{
+	this->identityTracking = enabled;
+
+	if (enabled == false)
+	{
+		clusterIdentifiers.clear();
+		previousPixelCluster.clear();
+		previousClusterIdentifiers.clear();
+		previousIdentityCentres.clear();
+		identityMatchingPending = false;
+	}
+}
+
+bool SLIC::seedCentresFromPyramid(const PlanarImage& image)
+{
+	const unsigned scaleFactor = 1u << pyramidLevels;
+
+	/* Nearest coarse step: it only sizes the search regions and weighs the
+	spatial distance, the number of clusters comes from the seeds below. */
+	const unsigned coarseSamplingStep = (samplingStep + scaleFactor / 2) / scaleFactor;
+
+	/* The coarse grid must still be meaningful. */
+	if (pyramidLevels == 0 || coarseSamplingStep < 2 ||
+		image.cols < static_cast<int>(2 * samplingStep) || image.rows < static_cast<int>(2 * samplingStep))
+		return false;
+
+	Mat coarseImage;
+	image.downscale(scaleFactor, coarseImage);
+
+	/* A coarse pixel covers scaleFactor x scaleFactor pixels around its
+	centre. */
+	const double offset = (scaleFactor - 1) / 2.0;
+
+	/* Seed the coarse frame with the centres of the full resolution grid,
+	so that the number of clusters is kept whatever the rounding of the
+	step. */
+	std::vector<double> coarseSeeds;
+
+	for (int y = samplingStep; y < image.rows; y += samplingStep)
+		for (int x = samplingStep; x < image.cols; x += samplingStep)
+		{
+			const Point lowestGradientPixel = findLowestGradient(image, Point(x, y));
+			const Vec3b pixelColor = image.pixel(lowestGradientPixel.y, lowestGradientPixel.x);
+
+			coarseSeeds.push_back(pixelColor.val[0]);
+			coarseSeeds.push_back(pixelColor.val[1]);
+			coarseSeeds.push_back(pixelColor.val[2]);
+			coarseSeeds.push_back(std::min(std::max((lowestGradientPixel.x - offset) / scaleFactor, 0.0), coarseImage.cols - 1.0));
+			coarseSeeds.push_back(std::min(std::max((lowestGradientPixel.y - offset) / scaleFactor, 0.0), coarseImage.rows - 1.0));
+		}
+
+	/* Run the early iterations on the downscaled frame, with the sampling
+	step scaled to match. */
+	SLIC coarseSLIC;
+	coarseSLIC.setSeedCentres(coarseSeeds);
+	coarseSLIC.createSuperpixels(
+		coarseImage, coarseSamplingStep, spatialDistanceWeight, pyramidCoarseIterations, 0,
+		FIXED_ITERATIONS, NAIVE, 1, 0, false);
+
+	/* Bring the coarse centres back to full resolution. */
+	for (unsigned n = 0; n < coarseSLIC.clustersNumber; ++n)
+	{
+		const double centre[5] = {
+			coarseSLIC.clusterCentres[5 * n],
+			coarseSLIC.clusterCentres[5 * n + 1],
+			coarseSLIC.clusterCentres[5 * n + 2],
+			coarseSLIC.clusterCentres[5 * n + 3] * scaleFactor + offset,
+			coarseSLIC.clusterCentres[5 * n + 4] * scaleFactor + offset };
+
+		for (int c = 0; c < 5; ++c)
+		{
+			clusterCentres.push_back(centre[c]);
+			previousClusterCentres.push_back(centre[c]);
+		}
+
+		pixelsOfSameCluster.push_back(0);
+		residualError.push_back(0);
+	}
+
+	return true;
+}
+
+void SLIC::setPyramidParameters(
+	const unsigned levels,
+	const unsigned coarseIterations,
+	const unsigned finalIterations)
+{
+	this->pyramidLevels = levels;
+	this->pyramidCoarseIterations = std::max(coarseIterations, 1u);
+	this->pyramidFinalIterations = std::max(finalIterations, 1u);
+}
+
+void SLIC::setArithmetic(const SLICArithmetic arithmetic)
+{
+	this->arithmetic = arithmetic;
+}
+
+void SLIC::setPixelStateLayout(const PixelStateLayout layout)
+{
+	this->pixelStateLayout = layout;
+}
+
+void SLIC::setAssignmentSchedule(const AssignmentSchedule schedule)
+{
+	this->assignmentSchedule = schedule;
+}
+
+void SLIC::setRelabellingPeriod(const unsigned period)
+{
+	this->relabellingPeriod = period;
+}
+
+const BandSweepStatistics& SLIC::getBandSweepStatistics() const
+{
+	return bandSweepStatistics;
+}
+
+const std::vector<unsigned>& SLIC::getLastClusterPermutation() const
+{
+	return lastClusterPermutation;
+}
+
+void SLIC::setRowSplitting(const unsigned rowSplits)
+{
+	this->rowSplitting = rowSplits;
+}
+
+unsigned SLIC::getLastRowSplits() const
+{
+	return lastRowSplits;
+}
+
+void SLIC::setSeedCentres(const std::vector<double>& centres)
+{
+	this->seedCentres.assign(centres.begin(), centres.begin() + (centres.size() / 5) * 5);
+	this->seedCentresContinueChain = false;
+}
+
+void SLIC::setPreviousFrameCentres(
+	const std::vector<double>& centres,
+	const unsigned             framesNumber,
+	const unsigned             totalFramesNumber)
+{
+	setSeedCentres(centres);
+	this->seedCentresContinueChain = true;
+	this->framesNumber = framesNumber;
+	this->totalFramesNumber = totalFramesNumber;
+}
+
+unsigned SLIC::getFramesNumber() const
+{
+	return framesNumber;
+}
+
+unsigned SLIC::getTotalFramesNumber() const
+{
+	return totalFramesNumber;
+}
+
+void SLIC::setIterationCallback(const IterationCallback& callback)
+{
+	this->iterationCallback = callback;
+}
+
+void SLIC::setNoiseSeed(const unsigned long long seed)
+{
+	this->noiseGenerator.SetSeed(seed);
+}
+
+#ifdef SLIC_INSTRUMENTATION
+SLICInstrumentation& SLIC::getInstrumentation()
+{
+	return instrumentation;
+}
+#endif
+
+const std::vector<double>& SLIC::getClusterCentres() const
+{
+	return clusterCentres;
+}
+
+void SLIC::setSubsampledIterations(const unsigned iterations)
+{
+	this->subsampledIterations = std::min(iterations, 2u);
+}
+
+Point SLIC::findLowestGradient(
+	const PlanarImage& image,
+	const cv::Point&   centre)
+{
+	unsigned lowestGradient = UINT_MAX;
+	Point lowestGradientPoint = Point(centre.x, centre.y);
+
+	for (int y = centre.y - 1; y <= centre.y + 1 && y < image.rows - 1; ++y)
+		for (int x = centre.x - 1; x <= centre.x + 1 && x < image.cols - 1; ++x)
+		{
+			/* Exclude pixels on borders. */
+			if (x < 1 || y < 1)
+				continue;
+
+			/* Compute horizontal and vertical gradients and keep track
+			of the minimum. */
+			unsigned tempGradient =
+				(image.pixel(y, x + 1).val[0] - image.pixel(y, x - 1).val[0]) *
+				(image.pixel(y, x + 1).val[0] - image.pixel(y, x - 1).val[0]) +
+				(image.pixel(y - 1, x).val[0] - image.pixel(y + 1, x).val[0]) *
+				(image.pixel(y - 1, x).val[0] - image.pixel(y + 1, x).val[0]);
+
+			if (tempGradient < lowestGradient)
+			{
+				lowestGradient = tempGradient;
+				lowestGradientPoint.x = x;
+				lowestGradientPoint.y = y;
+			}
+		}
+
+	return lowestGradientPoint;
+}
+
+double SLIC::computeDistance(
+	const int        centreIndex,
+	const cv::Point& pixelPosition,
+	const cv::Vec3b& pixelColor)
+{
+	/* Compute the color distance between two pixels. */
+	double colorDistance =
+		(clusterCentres[5 * centreIndex] - pixelColor.val[0]) *
+		(clusterCentres[5 * centreIndex] - pixelColor.val[0]) +
+		(clusterCentres[5 * centreIndex + 1] - pixelColor.val[1]) *
+		(clusterCentres[5 * centreIndex + 1] - pixelColor.val[1]) +
+		(clusterCentres[5 * centreIndex + 2] - pixelColor.val[2]) *
+		(clusterCentres[5 * centreIndex + 2] - pixelColor.val[2]);
+
+	/* Compute the spatial distance between two pixels. */
+	double spaceDistance =
+		(clusterCentres[5 * centreIndex + 3] - pixelPosition.x) *
+		(clusterCentres[5 * centreIndex + 3] - pixelPosition.x) +
+		(clusterCentres[5 * centreIndex + 4] - pixelPosition.y) *
+		(clusterCentres[5 * centreIndex + 4] - pixelPosition.y);
+
+	/* Compute total distance between two pixels using the formula
+	described in the paper. */
+	return colorDistance + distanceFactor * spaceDistance;
+}
+
+void SLIC::assignClusterPixels(
+	const PlanarImage&   image,
+	const unsigned       centreIndex,
+	VideoElaborationMode videoMode,
+	const int            firstRow,
+	const int            endRow)
+{
+	/* When subsampling, only one pixel every two columns (and every two
+	rows for a quarter of the pixels) is evaluated. */
+	const int pixelStep = (samplingLevel > 0) ? 2 : 1;
+
+	const double centreL = clusterCentres[5 * centreIndex];
+	const double centreA = clusterCentres[5 * centreIndex + 1];
+	const double centreB = clusterCentres[5 * centreIndex + 2];
+	const double centreX = clusterCentres[5 * centreIndex + 3];
+	const double centreY = clusterCentres[5 * centreIndex + 4];
+
+	/* For each cluster, look for pixels in a 2 x step by 2 x step region
+	only, clipped to the image once instead of testing every pixel. */
+	const int    firstX = static_cast<int>(centreX) - static_cast<int>(samplingStep) - 1;
+	const int    firstY = std::max(static_cast<int>(centreY) - static_cast<int>(samplingStep) - 1, std::max(firstRow, 0));
+	const double endX = std::min(centreX + samplingStep + 1, static_cast<double>(image.cols));
+	const double endY = std::min(centreY + samplingStep + 1, static_cast<double>(std::min(endRow, image.rows)));
+
+	const bool findOrphans = (videoMode == ADD_SUPERPIXELS || videoMode == ADD_SUPERPIXELS_NOISE);
+
+	unsigned long long evaluations = 0;
+
+	for (int y = firstY; y < endY; ++y)
+	{
+		if (samplingLevel > 1 && ((y + (samplingOffset >> 1)) & 1))
+			continue;
+
+		/* The subsampled columns keep their parity from the region start,
+		so the first column is only clipped to the image afterwards. */
+		int x = firstX;
+		if (samplingLevel > 0 && isPixelSampled(x, y) == false)
+			++x;
+		while (x < 0)
+			x += pixelStep;
+
+		const double         rowTerm = (centreY - y) * (centreY - y);
+		const PlanarImageRow pixels = image.pixelRow(y);
+		double*              distance = &distanceFromClusterCentre[y * image.cols];
+		int*                 label = &pixelCluster[y * image.cols];
+
+		for (; x < endX; x += pixelStep)
+		{
+			const Vec3b pixelColor = pixels.pixel(x);
+
+			/* The distance of computeDistance, with the centre and the row
+			term read once per region. */
+			const double colorDistance =
+				(centreL - pixelColor.val[0]) * (centreL - pixelColor.val[0]) +
+				(centreA - pixelColor.val[1]) * (centreA - pixelColor.val[1]) +
+				(centreB - pixelColor.val[2]) * (centreB - pixelColor.val[2]);
+			const double tempDistance =
+				colorDistance + distanceFactor * ((centreX - x) * (centreX - x) + rowTerm);
+			++evaluations;
+
+			/* This pixel has been searched */
+			if (findOrphans)
+				pixelReachedByClusters[y * image.cols + x] = 0;
+
+			/* Update pixel's cluster if this distance is smaller
+			than pixel's previous distance. Ties go to the lowest
+			cluster index, as in the packed words, so that the labels
+			do not depend on the order of the clusters. */
+			if (tempDistance < distance[x] ||
+				(tempDistance == distance[x] && static_cast<int>(centreIndex) < label[x]))
+			{
+				distance[x] = tempDistance;
+
+				/* The cached contributions of the tile are no longer valid. */
+				if (backgroundFrozen && label[x] != static_cast<int>(centreIndex))
+					tileContributionsStale[(y / tileSize) * tilesPerRow + x / tileSize] = 1;
+
+				label[x] = centreIndex;
+			}
+		}
+	}
+
+	SLIC_COUNT_PIXEL_EVALUATIONS(instrumentation, evaluations);
+}
+
+void SLIC::assignClusterPixelsFixedPoint(
+	const PlanarImage&   image,
+	const unsigned       centreIndex,
+	VideoElaborationMode videoMode,
+	const int            firstRow,
+	const int            endRow)
+{
+	/* Centre color in 1/16 units, so that squared differences of 8-bit
+	values fit comfortably in 32 bits. */
+	const int centreL = (fixedCentreColors[3 * centreIndex] + 8) >> 4;
+	const int centreA = (fixedCentreColors[3 * centreIndex + 1] + 8) >> 4;
+	const int centreB = (fixedCentreColors[3 * centreIndex + 2] + 8) >> 4;
+	const int centreX = fixedCentrePositions[2 * centreIndex];
+	const int centreY = fixedCentrePositions[2 * centreIndex + 1];
+
+	/* The same 2 x step by 2 x step region as assignClusterPixels,
+	clipped to the image once instead of testing every pixel. */
+	const int firstX = std::max((centreX >> 4) - static_cast<int>(samplingStep) - 1, 0);
+	const int firstY = std::max((centreY >> 4) - static_cast<int>(samplingStep) - 1, std::max(firstRow, 0));
+	const int endX = std::min(((centreX + 15) >> 4) + static_cast<int>(samplingStep) + 1, image.cols);
+	const int endY = std::min(((centreY + 15) >> 4) + static_cast<int>(samplingStep) + 1, std::min(endRow, image.rows));
+
+	if (firstX >= endX || firstY >= endY)
+		return;
+
+	/* The spatial term along x only depends on the column, so it is looked
+	up once for the whole region and the inner loop only reads memory
+	sequentially. */
+	std::vector<int> columnTerms(endX - firstX);
+
+	for (int x = firstX; x < endX; ++x)
+		columnTerms[x - firstX] = spatialDistanceTable[abs((x << 4) - centreX)];
+
+	const int pixelStep = (samplingLevel > 0) ? 2 : 1;
+
+	/* The planes are read through their own strides and subsampling, so
+	interleaved, planar and NV12 frames share the loop. */
+	const int stepL = image.pixelSteps[0];
+	const int stepA = image.pixelSteps[1];
+	const int stepB = image.pixelSteps[2];
+	const int shiftL = image.columnShifts[0];
+	const int shiftA = image.columnShifts[1];
+	const int shiftB = image.columnShifts[2];
+
+	unsigned long long evaluations = 0;
+
+	const bool findOrphans = (videoMode == ADD_SUPERPIXELS || videoMode == ADD_SUPERPIXELS_NOISE);
+
+	for (int y = firstY; y < endY; ++y)
+	{
+		if (samplingLevel > 1 && ((y + (samplingOffset >> 1)) & 1))
+			continue;
+
+		const int    rowTerm = spatialDistanceTable[abs((y << 4) - centreY)];
+		const uchar* rowL = image.row(0, y);
+		const uchar* rowA = image.row(1, y);
+		const uchar* rowB = image.row(2, y);
+		int*         distance = &fixedDistanceFromClusterCentre[y * image.cols];
+		int*         label = &pixelCluster[y * image.cols];
+
+		int x = firstX;
+		if (samplingLevel > 0 && isPixelSampled(x, y) == false)
+			++x;
+
+		evaluations += (endX - x + pixelStep - 1) / pixelStep;
+
+		/* The evaluated pixels have been searched, as in assignClusterPixels. */
+		if (findOrphans)
+		{
+			uchar* reached = &pixelReachedByClusters[y * image.cols];
+
+			for (int reachedX = x; reachedX < endX; reachedX += pixelStep)
+				reached[reachedX] = 0;
+		}
+
+		for (; x < endX; x += pixelStep)
+		{
+			const int differenceL = (rowL[(x >> shiftL) * stepL] << 4) - centreL;
+			const int differenceA = (rowA[(x >> shiftA) * stepA] << 4) - centreA;
+			const int differenceB = (rowB[(x >> shiftB) * stepB] << 4) - centreB;
+
+			const int tempDistance =
+				differenceL * differenceL + differenceA * differenceA + differenceB * differenceB +
+				rowTerm + columnTerms[x - firstX];
+
+			/* Ties go to the lowest cluster index. */
+			if (tempDistance < distance[x] ||
+				(tempDistance == distance[x] && static_cast<int>(centreIndex) < label[x]))
+			{
+				distance[x] = tempDistance;
+				label[x] = centreIndex;
+			}
+		}
+	}
+
+	SLIC_COUNT_PIXEL_EVALUATIONS(instrumentation, evaluations);
+}
+
+void SLIC::updateCentresFixedPoint(
+	const PlanarImage&   image,
+	VideoElaborationMode videoMode,
+	const int            sampleWeight)
+{
+	/* Convert the centres; after the first iteration they come from the
+	integer centres, so the conversion is exact. */
+	fixedCentreColors.resize(3 * clustersNumber);
+	fixedCentrePositions.resize(2 * clustersNumber);
+
+	for (unsigned centreIndex = 0; centreIndex < clustersNumber; ++centreIndex)
+	{
+		for (int n = 0; n < 3; ++n)
+			fixedCentreColors[3 * centreIndex + n] = static_cast<unsigned short>(
+				std::min(std::max(cvRound(clusterCentres[5 * centreIndex + n] * 256), 0), 65535));
+
+		fixedCentrePositions[2 * centreIndex] = cvRound(clusterCentres[5 * centreIndex + 3] * 16);
+		fixedCentrePositions[2 * centreIndex + 1] = cvRound(clusterCentres[5 * centreIndex + 4] * 16);
+	}
+
+	/* Spatial distances are looked up instead of scaled by distanceFactor:
+	they are never farther than the search region plus one pixel. */
+	const size_t tableSize = 16 * (samplingStep + 3);
+
+	if (spatialDistanceTable.size() != tableSize)
+	{
+		spatialDistanceTable.resize(tableSize);
+
+		for (size_t d = 0; d < tableSize; ++d)
+			spatialDistanceTable[d] = cvRound(distanceFactor * d * d);
+	}
+
+	{
+		SLIC_PHASE_TIMER(instrumentation, PHASE_ASSIGNMENT);
+
+		/* Reset distance values. */
+		fixedDistanceFromClusterCentre.assign(pixelsNumber, INT_MAX);
+
+		scheduleClusterAssignment(image, nullptr, [=](unsigned centreIndex, int firstRow, int endRow)
+		{
+			assignClusterPixelsFixedPoint(image, centreIndex, videoMode, firstRow, endRow);
+		});
+	}
+
+	SLIC_PHASE_TIMER(instrumentation, PHASE_ACCUMULATION);
+
+	/* Sum the information of the evaluated pixels of each cluster. */
+	fixedClusterSums.assign(5 * clustersNumber, 0);
+	pixelsOfSameCluster.assign(clustersNumber, 0);
+
+	const int stepL = image.pixelSteps[0];
+	const int stepA = image.pixelSteps[1];
+	const int stepB = image.pixelSteps[2];
+	const int shiftL = image.columnShifts[0];
+	const int shiftA = image.columnShifts[1];
+	const int shiftB = image.columnShifts[2];
+
+	for (int y = 0; y < image.rows; ++y)
+	{
+		const uchar* rowL = image.row(0, y);
+		const uchar* rowA = image.row(1, y);
+		const uchar* rowB = image.row(2, y);
+		const int*   label = &pixelCluster[y * image.cols];
+
+		for (int x = 0; x < image.cols; ++x)
+			if (label[x] != -1 && isPixelSampled(x, y))
+			{
+				long long* sums = &fixedClusterSums[5 * label[x]];
+
+				sums[0] += sampleWeight * rowL[(x >> shiftL) * stepL];
+				sums[1] += sampleWeight * rowA[(x >> shiftA) * stepA];
+				sums[2] += sampleWeight * rowB[(x >> shiftB) * stepB];
+				sums[3] += sampleWeight * x;
+				sums[4] += sampleWeight * y;
+
+				pixelsOfSameCluster[label[x]] += sampleWeight;
+			}
+	}
+
+	/* The sums are normalized by finishClusterCentres, together with
+	the other per-cluster steps. */
+}
+
+void SLIC::assignClusterPixelsPacked(
+	const PlanarImage& image,
+	const unsigned     centreIndex,
+	const int          firstRow,
+	const int          endRow)
+{
+	const int pixelStep = (samplingLevel > 0) ? 2 : 1;
+
+	/* The same 2 x step by 2 x step region as assignClusterPixels,
+	clipped to the image. */
+	const int    firstX = std::max(static_cast<int>(clusterCentres[5 * centreIndex + 3]) - static_cast<int>(samplingStep) - 1, 0);
+	const int    firstY = std::max(static_cast<int>(clusterCentres[5 * centreIndex + 4]) - static_cast<int>(samplingStep) - 1, std::max(firstRow, 0));
+	const double endX = std::min(clusterCentres[5 * centreIndex + 3] + samplingStep + 1, static_cast<double>(image.cols));
+	const double endY = std::min(clusterCentres[5 * centreIndex + 4] + samplingStep + 1, static_cast<double>(std::min(endRow, image.rows)));
+
+	unsigned long long evaluations = 0;
+
+	for (int y = firstY; y < endY; ++y)
+	{
+		if (samplingLevel > 1 && ((y + (samplingOffset >> 1)) & 1))
+			continue;
+
+		int x = firstX;
+		if (samplingLevel > 0 && isPixelSampled(x, y) == false)
+			++x;
+
+		const PlanarImageRow pixels = image.pixelRow(y);
+
+		for (; x < endX; x += pixelStep)
+		{
+			const float distance = static_cast<float>(
+				computeDistance(centreIndex, Point(x, y), pixels.pixel(x)));
+			++evaluations;
+
+			unsigned distanceBits;
+			memcpy(&distanceBits, &distance, sizeof(distanceBits));
+
+			const unsigned long long word =
+				(static_cast<unsigned long long>(distanceBits) << 32) | centreIndex;
+
+			/* Atomic minimum: retry only while this cluster is still the
+			nearest one, so no lock is needed between clusters. */
+			std::atomic<unsigned long long>& state = packedPixelState[y * image.cols + x];
+			unsigned long long current = state.load(std::memory_order_relaxed);
+
+			while (word < current &&
+				state.compare_exchange_weak(current, word, std::memory_order_relaxed) == false);
+		}
+	}
+
+	SLIC_COUNT_PIXEL_EVALUATIONS(instrumentation, evaluations);
+}
+
+void SLIC::updateCentresPacked(
+	const PlanarImage&   image,
+	VideoElaborationMode videoMode,
+	const int            sampleWeight)
+{
+	if (packedPixelStateSize != pixelsNumber)
+	{
+		packedPixelState.reset(new std::atomic<unsigned long long>[pixelsNumber]);
+		packedPixelStateSize = pixelsNumber;
+	}
+
+	{
+		SLIC_PHASE_TIMER(instrumentation, PHASE_ASSIGNMENT);
+
+		/* Reset distance values. */
+		tbb::parallel_for<int>(0, image.rows, 1, [=](int y)
+		{
+			for (int x = 0; x < image.cols; ++x)
+				packedPixelState[y * image.cols + x].store(ULLONG_MAX, std::memory_order_relaxed);
+		});
+
+		/* Every pixel is updated atomically, so the row sub-ranges of the
+		clusters can run in any order. */
+		const unsigned rowSplits = chooseRowSplits(clustersNumber, 2 * samplingStep + 3);
+		lastRowSplits = rowSplits;
+
+		tbb::parallel_for(tbb::blocked_range<unsigned>(0, clustersNumber * rowSplits), [=](const tbb::blocked_range<unsigned>& range)
+		{
+			SLIC_TRACE_SCOPE("cluster tasks", "task", range.size());
+
+			for (unsigned task = range.begin(); task != range.end(); ++task)
+			{
+				const unsigned centreIndex = task / rowSplits;
+				const unsigned split = task % rowSplits;
+				const int      windowY = static_cast<int>(clusterCentres[5 * centreIndex + 4]) - static_cast<int>(samplingStep) - 1;
+				const int      windowRows = 2 * samplingStep + 3;
+
+				assignClusterPixelsPacked(image, centreIndex,
+					(split == 0) ? 0 : windowY + static_cast<int>(windowRows * split / rowSplits),
+					(split + 1 == rowSplits) ? INT_MAX : windowY + static_cast<int>(windowRows * (split + 1) / rowSplits));
+			}
+		});
+	}
+
+	SLIC_PHASE_TIMER(instrumentation, PHASE_ACCUMULATION);
+
+	/* Reset centres values and the number of pixel
+	per cluster to zero. */
+	clusterCentres.assign(clustersNumber * 5, 0);
+	pixelsOfSameCluster.assign(clustersNumber, 0);
+
+	const bool findOrphans =
+		(videoMode == ADD_SUPERPIXELS || videoMode == ADD_SUPERPIXELS_NOISE) && samplingLevel == 0;
+
+	/* Unpack the labels and compute the new cluster centres. Pixels not
+	reached by any cluster keep their previous label. */
+	for (int y = 0; y < image.rows; ++y)
+	{
+		const PlanarImageRow pixels = image.pixelRow(y);
+
+		for (int x = 0; x < image.cols; ++x)
+		{
+			const unsigned long long word =
+				packedPixelState[y * image.cols + x].load(std::memory_order_relaxed);
+
+			if (word != ULLONG_MAX)
+			{
+				pixelCluster[y * image.cols + x] = static_cast<int>(word & 0xffffffff);
+
+				/* This pixel has been searched */
+				if (findOrphans)
+					pixelReachedByClusters[y * image.cols + x] = 0;
+			}
+
+			int currentPixelCluster = pixelCluster[y * image.cols + x];
+
+			if (currentPixelCluster != -1 && isPixelSampled(x, y))
+			{
+				Vec3b pixelColor = pixels.pixel(x);
+
+				clusterCentres[5 * currentPixelCluster] += sampleWeight * pixelColor.val[0];
+				clusterCentres[5 * currentPixelCluster + 1] += sampleWeight * pixelColor.val[1];
+				clusterCentres[5 * currentPixelCluster + 2] += sampleWeight * pixelColor.val[2];
+				clusterCentres[5 * currentPixelCluster + 3] += sampleWeight * x;
+				clusterCentres[5 * currentPixelCluster + 4] += sampleWeight * y;
+
+				pixelsOfSameCluster[currentPixelCluster] += sampleWeight;
+			}
+		}
+	}
+
+	/* The sums are normalized by finishClusterCentres. */
+}
+
+unsigned SLIC::chooseRowSplits(
+	const unsigned tasksNumber,
+	const int      windowRows) const
+{
+	if (rowSplitting != 0)
+		return std::min(rowSplitting, static_cast<unsigned>(std::max(windowRows, 1)));
+
+	/* A few tasks per thread balance the load at the tail; sub-ranges
+	are kept tall enough to amortize the task and the row setup. */
+	const unsigned minimumSplitRows = 16;
+	const unsigned tasksPerThread = 4;
+	const unsigned wantedTasks = tasksPerThread * static_cast<unsigned>(tbb::this_task_arena::max_concurrency());
+
+	if (tasksNumber == 0 || tasksNumber >= wantedTasks)
+		return 1;
+
+	const unsigned rowSplits = (wantedTasks + tasksNumber - 1) / tasksNumber;
+
+	return std::max(std::min(rowSplits, static_cast<unsigned>(windowRows) / minimumSplitRows), 1u);
+}
+
+void SLIC::scheduleClusterAssignment(
+	const PlanarImage&                             image,
+	const std::vector<unsigned>*                   clusters,
+	const std::function<void(unsigned, int, int)>& assignCluster)
+{
+	const unsigned scheduledNumber =
+		(clusters != nullptr) ? static_cast<unsigned>(clusters->size()) : clustersNumber;
+
+	if (assignmentSchedule == CLUSTER_PARALLEL)
+	{
+		/* The sub-ranges of a search region are disjoint, so splitting it
+		adds no conflict to those between neighbouring clusters. */
+		const int      windowRows = 2 * samplingStep + 3;
+		const unsigned rowSplits = chooseRowSplits(scheduledNumber, windowRows);
+		lastRowSplits = rowSplits;
+
+		/* Each range of tasks run by a thread is a trace event. */
+		tbb::parallel_for(tbb::blocked_range<unsigned>(0, scheduledNumber * rowSplits), [&](const tbb::blocked_range<unsigned>& range)
+		{
+			SLIC_TRACE_SCOPE("cluster tasks", "task", range.size());
+
+			for (unsigned task = range.begin(); task != range.end(); ++task)
+			{
+				const unsigned centreIndex = (clusters != nullptr) ? (*clusters)[task / rowSplits] : task / rowSplits;
+				const unsigned split = task % rowSplits;
+				const int      windowY = static_cast<int>(clusterCentres[5 * centreIndex + 4]) - static_cast<int>(samplingStep) - 1;
+
+				assignCluster(centreIndex,
+					(split == 0) ? 0 : windowY + static_cast<int>(windowRows * split / rowSplits),
+					(split + 1 == rowSplits) ? INT_MAX : windowY + static_cast<int>(windowRows * (split + 1) / rowSplits));
+			}
+		});
+
+		return;
+	}
+
+	/* A search region spans less than 2 x (step + 2) pixels around the
+	centre, so two clusters whose cells are three cells apart never
+	share a pixel. Cells follow the current centres, so the grid stays
+	valid after noise displacement and added superpixels. */
+	centresGrid.reset(image.cols, image.rows, samplingStep + 2);
+
+	for (unsigned n = 0; n < scheduledNumber; ++n)
+	{
+		const unsigned centreIndex = (clusters != nullptr) ? (*clusters)[n] : n;
+
+		centresGrid.insert(centreIndex, clusterCentres[5 * centreIndex + 3], clusterCentres[5 * centreIndex + 4]);
+	}
+
+	const int cellsPerRow = centresGrid.getCellsPerRow();
+	const int cellsPerColumn = centresGrid.getCellsPerColumn();
+	const int cellSize = centresGrid.getCellSize();
+
+	/* The rows reached by the clusters of a cell are split in absolute
+	sub-ranges: each task runs all the clusters of the cell in the same
+	order on its rows, so the labels do not depend on the split. */
+	const int      cellRows = cellSize + 2 * (samplingStep + 2);
+	const unsigned rowSplits = chooseRowSplits((cellsPerRow * cellsPerColumn + 8) / 9, cellRows);
+	lastRowSplits = rowSplits;
+
+	/* One parallel phase per colour; the clusters of a cell run one
+	after the other. */
+	for (int colour = 0; colour < 9; ++colour)
+	{
+		const int firstCellX = colour % 3;
+		const int firstCellY = colour / 3;
+
+		if (firstCellX >= cellsPerRow || firstCellY >= cellsPerColumn)
+			continue;
+
+		const int colourCellsPerRow = (cellsPerRow - firstCellX + 2) / 3;
+		const int colourCellsPerColumn = (cellsPerColumn - firstCellY + 2) / 3;
+
+		tbb::parallel_for(tbb::blocked_range<int>(0, colourCellsPerRow * colourCellsPerColumn * rowSplits), [&](const tbb::blocked_range<int>& range)
+		{
+			SLIC_TRACE_SCOPE("cell tasks", "task", range.size());
+
+			for (int task = range.begin(); task != range.end(); ++task)
+			{
+				const int n = task / rowSplits;
+				const int split = task % rowSplits;
+				const int cellY = firstCellY + 3 * (n / colourCellsPerRow);
+				const int windowY = cellY * cellSize - static_cast<int>(samplingStep) - 2;
+
+				const std::vector<unsigned>& cellCentres = centresGrid.getCellCentres(
+					firstCellX + 3 * (n % colourCellsPerRow), cellY);
+
+				const int firstRow = (split == 0) ? 0 : windowY + cellRows * split / rowSplits;
+				const int endRow = (split + 1 == static_cast<int>(rowSplits)) ? INT_MAX : windowY + cellRows * (split + 1) / rowSplits;
+
+				for (size_t k = 0; k < cellCentres.size(); ++k)
+					assignCluster(cellCentres[k], firstRow, endRow);
+			}
+		});
+	}
+}
+
+void SLIC::assignPixelsFromCentres(
+	const PlanarImage&   image,
+	VideoElaborationMode videoMode)
+{
+	centresGrid.build(clusterCentres, clustersNumber, image.cols, image.rows, samplingStep + 2);
+
+	const int  cellSize = centresGrid.getCellSize();
+	const int  cellsPerRow = centresGrid.getCellsPerRow();
+	const bool findOrphans = (videoMode == ADD_SUPERPIXELS || videoMode == ADD_SUPERPIXELS_NOISE);
+
+	/* Each cell of the grid is a block of pixels sharing the same
+	candidate centres. */
+	tbb::parallel_for<int>(0, cellsPerRow * centresGrid.getCellsPerColumn(), 1, [=](int cellIndex)
+	{
+		const int firstX = (cellIndex % cellsPerRow) * cellSize;
+		const int firstY = (cellIndex / cellsPerRow) * cellSize;
+		const int endX = std::min(firstX + cellSize, image.cols);
+		const int endY = std::min(firstY + cellSize, image.rows);
+
+		/* Same ties as the clusters running in index order. */
+		std::vector<unsigned> candidates;
+		centresGrid.findNearbyCentres(firstX, firstY, candidates);
+		std::sort(candidates.begin(), candidates.end());
+
+		unsigned long long evaluations = 0;
+
+		for (int y = firstY; y < endY; ++y)
+		{
+			const PlanarImageRow pixels = image.pixelRow(y);
+
+			for (int x = firstX; x < endX; ++x)
+			{
+				if (isPixelSampled(x, y) == false)
+					continue;
+
+				const Vec3b pixelColor = pixels.pixel(x);
+
+				int    nearestCentre = -1;
+				double nearestDistance = DBL_MAX;
+
+				for (size_t n = 0; n < candidates.size(); ++n)
+				{
+					const unsigned centreIndex = candidates[n];
+
+					/* The 2 x step by 2 x step region of the cluster. */
+					if (x < static_cast<int>(clusterCentres[5 * centreIndex + 3]) - static_cast<int>(samplingStep) - 1 ||
+						x >= clusterCentres[5 * centreIndex + 3] + samplingStep + 1 ||
+						y < static_cast<int>(clusterCentres[5 * centreIndex + 4]) - static_cast<int>(samplingStep) - 1 ||
+						y >= clusterCentres[5 * centreIndex + 4] + samplingStep + 1)
+						continue;
+
+					const double tempDistance =
+						computeDistance(centreIndex, Point(x, y), pixelColor);
+					++evaluations;
+
+					/* Ties go to the lowest cluster index. */
+					if (tempDistance < nearestDistance ||
+						(tempDistance == nearestDistance && static_cast<int>(centreIndex) < nearestCentre))
+					{
+						nearestDistance = tempDistance;
+						nearestCentre = centreIndex;
+					}
+				}
+
+				/* Orphan pixel: it keeps its label, as in the cluster-centric
+				schedules, and is left to the blob detector. */
+				if (nearestCentre == -1)
+					continue;
+
+				/* This pixel has been searched */
+				if (findOrphans)
+					pixelReachedByClusters[y * image.cols + x] = 0;
+
+				distanceFromClusterCentre[y * image.cols + x] = nearestDistance;
+				pixelCluster[y * image.cols + x] = nearestCentre;
+			}
+		}
+
+		SLIC_COUNT_PIXEL_EVALUATIONS(instrumentation, evaluations);
+	});
+}
+
+void SLIC::relabelClustersInMortonOrder()
+{
+	/* Interleave the bits of the coordinates of the grid cell holding
+	each centre; ties keep the old order. */
+	auto spreadBits = [](unsigned value)
+	{
+		value &= 0xffff;
+		value = (value | (value << 8)) & 0x00ff00ff;
+		value = (value | (value << 4)) & 0x0f0f0f0f;
+		value = (value | (value << 2)) & 0x33333333;
+		value = (value | (value << 1)) & 0x55555555;
+
+		return value;
+	};
+
+	std::vector<std::pair<unsigned, unsigned>> order(clustersNumber);
+
+	for (unsigned centreIndex = 0; centreIndex < clustersNumber; ++centreIndex)
+	{
+		const unsigned cellX = static_cast<unsigned>(std::max(clusterCentres[5 * centreIndex + 3], 0.0)) / samplingStep;
+		const unsigned cellY = static_cast<unsigned>(std::max(clusterCentres[5 * centreIndex + 4], 0.0)) / samplingStep;
+
+		order[centreIndex] = std::make_pair(spreadBits(cellX) | (spreadBits(cellY) << 1), centreIndex);
+	}
+
+	std::sort(order.begin(), order.end());
+
+	lastClusterPermutation.resize(clustersNumber);
+
+	for (unsigned n = 0; n < clustersNumber; ++n)
+		lastClusterPermutation[order[n].second] = n;
+
+	/* Permute the per-cluster data. */
+	std::vector<double>       newClusterCentres(clusterCentres.size());
+	std::vector<double>       newPreviousClusterCentres(previousClusterCentres.size());
+	std::vector<int>          newPixelsOfSameCluster(pixelsOfSameCluster.size());
+	std::vector<double>       newResidualError(residualError.size());
+	std::vector<SuperpixelID> newClusterIdentifiers(clusterIdentifiers.size());
+
+	for (unsigned n = 0; n < clustersNumber; ++n)
+	{
+		const unsigned centreIndex = order[n].second;
+
+		for (int k = 0; k < 5; ++k)
+		{
+			newClusterCentres[5 * n + k] = clusterCentres[5 * centreIndex + k];
+			newPreviousClusterCentres[5 * n + k] = previousClusterCentres[5 * centreIndex + k];
+		}
+
+		newPixelsOfSameCluster[n] = pixelsOfSameCluster[centreIndex];
+		newResidualError[n] = residualError[centreIndex];
+
+		if (identityTracking)
+			newClusterIdentifiers[n] = clusterIdentifiers[centreIndex];
+	}
+
+	clusterCentres.swap(newClusterCentres);
+	previousClusterCentres.swap(newPreviousClusterCentres);
+	pixelsOfSameCluster.swap(newPixelsOfSameCluster);
+	residualError.swap(newResidualError);
+	clusterIdentifiers.swap(newClusterIdentifiers);
+
+	/* Relabel the pixels. */
+	tbb::parallel_for(tbb::blocked_range<unsigned>(0, pixelsNumber), [=](const tbb::blocked_range<unsigned>& range)
+	{
+		for (unsigned n = range.begin(); n < range.end(); ++n)
+			if (pixelCluster[n] != -1)
+				pixelCluster[n] = lastClusterPermutation[pixelCluster[n]];
+	});
+
+	/* Active clusters are selected again at every frame. */
+	activeClusters.clear();
+	clusterIsActive.assign(clustersNumber, 0);
+
+	/* The cached contributions refer to the old indexes. */
+	tileContributionsValid = false;
+}
+
+void SLIC::assignClustersInBands(
+	const PlanarImage&   image,
+	VideoElaborationMode videoMode)
+{
+	centresGrid.build(clusterCentres, clustersNumber, image.cols, image.rows, samplingStep + 2);
+
+	const int cellSize = centresGrid.getCellSize();
+	const int cellsPerRow = centresGrid.getCellsPerRow();
+	const int cellsPerColumn = centresGrid.getCellsPerColumn();
+	const int bandRows = 2 * samplingStep + 2;
+
+	/* Frame, labels and distances (and reached pixels when looking for
+	orphans). */
+	const size_t pixelBytes = image.elemSize() + sizeof(int) + sizeof(double) +
+		((videoMode == ADD_SUPERPIXELS || videoMode == ADD_SUPERPIXELS_NOISE) ? sizeof(uchar) : 0);
+
+	bandSweepStatistics.bandsNumber = (image.rows + bandRows - 1) / bandRows;
+	bandSweepStatistics.bandRows = bandRows;
+	bandSweepStatistics.bandBytes = bandRows * image.cols * pixelBytes;
+	bandSweepStatistics.sweepBytes = pixelsNumber * pixelBytes;
+	bandSweepStatistics.searchRegionsBytes = 0;
+
+	for (unsigned centreIndex = 0; centreIndex < clustersNumber; ++centreIndex)
+	{
+		const int firstX = std::max(static_cast<int>(clusterCentres[5 * centreIndex + 3]) - static_cast<int>(samplingStep) - 1, 0);
+		const int firstY = std::max(static_cast<int>(clusterCentres[5 * centreIndex + 4]) - static_cast<int>(samplingStep) - 1, 0);
+		const int endX = std::min(static_cast<int>(clusterCentres[5 * centreIndex + 3]) + static_cast<int>(samplingStep) + 2, image.cols);
+		const int endY = std::min(static_cast<int>(clusterCentres[5 * centreIndex + 4]) + static_cast<int>(samplingStep) + 2, image.rows);
+
+		if (firstX < endX && firstY < endY)
+			bandSweepStatistics.searchRegionsBytes += (endX - firstX) * (endY - firstY) * pixelBytes;
+	}
+
+	for (int firstRow = 0; firstRow < image.rows; firstRow += bandRows)
+	{
+		const int endRow = std::min(firstRow + bandRows, image.rows);
+
+		/* Rows of cells holding the centres which reach the band. */
+		const int firstCellY = std::max((firstRow - static_cast<int>(samplingStep) - 2) / cellSize, 0);
+		const int lastCellY = std::min((endRow + static_cast<int>(samplingStep) + 1) / cellSize, cellsPerColumn - 1);
+
+		/* Columns of cells three cells apart never share a pixel, so each
+		column class runs in parallel; the clusters of a column run one
+		after the other. */
+		for (int columnClass = 0; columnClass < 3 && columnClass < cellsPerRow; ++columnClass)
+		{
+			tbb::parallel_for<int>(0, (cellsPerRow - columnClass + 2) / 3, 1, [=](int n)
+			{
+				const int cellX = columnClass + 3 * n;
+
+				for (int cellY = firstCellY; cellY <= lastCellY; ++cellY)
+				{
+					const std::vector<unsigned>& cellCentres = centresGrid.getCellCentres(cellX, cellY);
+
+					for (size_t k = 0; k < cellCentres.size(); ++k)
+						assignClusterPixels(image, cellCentres[k], videoMode, firstRow, endRow);
+				}
+			});
+		}
+	}
+}
+
+bool SLIC::isPixelSampled(
+	const int x,
+	const int y)
+{
+	/* Checkerboard for half of the pixels, one pixel every 2 x 2 block
+	for a quarter of them. The offset moves the pattern at each
+	iteration, so that different pixels are evaluated. */
+	if (samplingLevel == 0)
+		return true;
+	if (samplingLevel == 1)
+		return ((x + y + samplingOffset) & 1) == 0;
+
+	return ((x + samplingOffset) & 1) == 0 && ((y + (samplingOffset >> 1)) & 1) == 0;
+}
+
+void SLIC::accumulateTileContributions(
+	const PlanarImage& image,
+	const unsigned     tileIndex)
+{
+	std::vector<TileContribution>& contributions = tileContributions[tileIndex];
+	contributions.clear();
+
+	const int tileX = (tileIndex % tilesPerRow) * tileSize;
+	const int tileY = (tileIndex / tilesPerRow) * tileSize;
+	const int tileEndX = std::min(tileX + static_cast<int>(tileSize), image.cols);
+	const int tileEndY = std::min(tileY + static_cast<int>(tileSize), image.rows);
+
+	/* Only a few clusters own pixels in a tile, and neighbor pixels
+	usually belong to the same one. */
+	size_t lastContribution = 0;
+
+	for (int y = tileY; y < tileEndY; ++y)
+	{
+		const PlanarImageRow pixels = image.pixelRow(y);
+
+		for (int x = tileX; x < tileEndX; ++x)
+		{
+			const int currentPixelCluster = pixelCluster[y * image.cols + x];
+
+			if (currentPixelCluster == -1)
+				continue;
+
+			if (lastContribution >= contributions.size() ||
+				contributions[lastContribution].cluster != currentPixelCluster)
+			{
+				lastContribution = 0;
+				while (lastContribution < contributions.size() &&
+					contributions[lastContribution].cluster != currentPixelCluster)
+					++lastContribution;
+
+				if (lastContribution == contributions.size())
+				{
+					TileContribution contribution = { currentPixelCluster, { 0, 0, 0, 0, 0 }, 0 };
+					contributions.push_back(contribution);
+				}
+			}
+
+			Vec3b pixelColor = pixels.pixel(x);
+			TileContribution& contribution = contributions[lastContribution];
+
+			contribution.sums[0] += pixelColor.val[0];
+			contribution.sums[1] += pixelColor.val[1];
+			contribution.sums[2] += pixelColor.val[2];
+			contribution.sums[3] += x;
+			contribution.sums[4] += y;
+
+			contribution.pixels += 1;
+		}
+	}
+}
+
+void SLIC::sumClusterContributions(
+	const PlanarImage& image,
+	const unsigned     centreIndex)
+{
+	double sums[5] = { 0, 0, 0, 0, 0 };
+	int    pixels = 0;
+
+	/* A pixel can only belong to a cluster which searched it, so the
+	tiles covered by the search region contain all its pixels. */
+	unsigned firstTileX, firstTileY, lastTileX, lastTileY;
+
+	if (getClusterTiles(centreIndex, image, firstTileX, firstTileY, lastTileX, lastTileY))
+		for (unsigned tileY = firstTileY; tileY < lastTileY; ++tileY)
+			for (unsigned tileX = firstTileX; tileX < lastTileX; ++tileX)
+				for (const TileContribution& contribution : tileContributions[tileY * tilesPerRow + tileX])
+					if (contribution.cluster == static_cast<int>(centreIndex))
+					{
+						for (int n = 0; n < 5; ++n)
+							sums[n] += contribution.sums[n];
+
+						pixels += contribution.pixels;
+					}
+
+	for (int n = 0; n < 5; ++n)
+		clusterCentres[5 * centreIndex + n] = sums[n];
+
+	pixelsOfSameCluster[centreIndex] = pixels;
+}
+
+void SLIC::normalizeClusterCentre(const unsigned centreIndex)
+{
+	/* Avoid empty clusters, if there are any. */
+	if (pixelsOfSameCluster[centreIndex] != 0)
+	{
+		clusterCentres[5 * centreIndex] /= pixelsOfSameCluster[centreIndex];
+		clusterCentres[5 * centreIndex + 1] /= pixelsOfSameCluster[centreIndex];
+		clusterCentres[5 * centreIndex + 2] /= pixelsOfSameCluster[centreIndex];
+		clusterCentres[5 * centreIndex + 3] /= pixelsOfSameCluster[centreIndex];
+		clusterCentres[5 * centreIndex + 4] /= pixelsOfSameCluster[centreIndex];
+	}
+}
+
+void SLIC::normalizeFixedPointCentre(const unsigned centreIndex)
+{
+	/* Empty clusters are reset, as in double precision. */
+	const long long  pixels = pixelsOfSameCluster[centreIndex];
+	const long long* sums = &fixedClusterSums[5 * centreIndex];
+
+	for (int n = 0; n < 3; ++n)
+	{
+		fixedCentreColors[3 * centreIndex + n] =
+			(pixels != 0) ? static_cast<unsigned short>((sums[n] * 256 + pixels / 2) / pixels) : 0;
+		clusterCentres[5 * centreIndex + n] = fixedCentreColors[3 * centreIndex + n] / 256.0;
+	}
+
+	for (int n = 0; n < 2; ++n)
+	{
+		fixedCentrePositions[2 * centreIndex + n] =
+			(pixels != 0) ? static_cast<int>((sums[3 + n] * 16 + pixels / 2) / pixels) : 0;
+		clusterCentres[5 * centreIndex + 3 + n] = fixedCentrePositions[2 * centreIndex + n] / 16.0;
+	}
+}
+
+double SLIC::updateResidualError(const unsigned centreIndex)
+{
+	/* Calculate residual error for each cluster centre. */
+	residualError[centreIndex] = sqrt(
+		(clusterCentres[5 * centreIndex + 4] - previousClusterCentres[5 * centreIndex + 4]) *
+		(clusterCentres[5 * centreIndex + 4] - previousClusterCentres[5 * centreIndex + 4]) +
+		(clusterCentres[5 * centreIndex + 3] - previousClusterCentres[5 * centreIndex + 3]) *
+		(clusterCentres[5 * centreIndex + 3] - previousClusterCentres[5 * centreIndex + 3]));
+
+	/* Update previous centres matrix. */
+	previousClusterCentres[5 * centreIndex] = clusterCentres[5 * centreIndex];
+	previousClusterCentres[5 * centreIndex + 1] = clusterCentres[5 * centreIndex + 1];
+	previousClusterCentres[5 * centreIndex + 2] = clusterCentres[5 * centreIndex + 2];
+	previousClusterCentres[5 * centreIndex + 3] = clusterCentres[5 * centreIndex + 3];
+	previousClusterCentres[5 * centreIndex + 4] = clusterCentres[5 * centreIndex + 4];
+
+	return residualError[centreIndex];
+}
+
+double SLIC::finishClusterCentres(
+	const PlanarImage&           image,
+	const std::vector<unsigned>* clusters,
+	const bool                   sumContributions)
+{
+	SLIC_PHASE_TIMER(instrumentation, PHASE_NORMALIZATION_RESIDUAL);
+
+	const unsigned finishedNumber = (clusters != nullptr) ?
+		static_cast<unsigned>(clusters->size()) : clustersNumber;
+
+	/* A block of clusters per task: with hundreds of thousands of
+	clusters, one task per cluster costs more than its work. Summing
+	the tile contributions is heavier, so those blocks are smaller. The
+	blocks are fixed, so the error sum is always added up in the same
+	order and the stopping iteration can be reproduced. */
+	const unsigned grainSize = sumContributions ? 64 : 1024;
+	const bool     firstIteration = (iterationIndex == 0);
+
+	return tbb::parallel_deterministic_reduce(
+		tbb::blocked_range<unsigned>(0, finishedNumber, grainSize), 0.0,
+		[&](const tbb::blocked_range<unsigned>& range, double errorSum) -> double
+	{
+		SLIC_TRACE_SCOPE("centre tasks", "task", range.size());
+
+		for (unsigned n = range.begin(); n != range.end(); ++n)
+		{
+			const unsigned centreIndex = (clusters != nullptr) ? (*clusters)[n] : n;
+
+			if (sumContributions)
+			{
+				sumClusterContributions(image, centreIndex);
+				normalizeClusterCentre(centreIndex);
+			}
+			else if (arithmetic == FIXED_POINT)
+				normalizeFixedPointCentre(centreIndex);
+			else
+				normalizeClusterCentre(centreIndex);
+
+			/* The first iteration of a frame only records the centres. */
+			if (firstIteration)
+				for (int k = 0; k < 5; ++k)
+					previousClusterCentres[5 * centreIndex + k] = clusterCentres[5 * centreIndex + k];
+			else
+				errorSum += updateResidualError(centreIndex);
+		}
+
+		return errorSum;
+	},
+		std::plus<double>());
+}
+
+void SLIC::detectChangedTiles(
+	const PlanarImage& image,
+	const bool         resetModel)
+{
+	tilesPerRow = (image.cols + tileSize - 1) / tileSize;
+	tilesPerColumn = (image.rows + tileSize - 1) / tileSize;
+
+	const unsigned tilesNumber = tilesPerRow * tilesPerColumn;
+
+	/* A new model is learnt from scratch, and every tile counts as changed. */
+	const bool learnModel = resetModel || backgroundModel.size() != 4 * tilesNumber;
+
+	if (learnModel)
+		backgroundModel.assign(4 * tilesNumber, 0);
+	changedTiles.assign(tilesNumber, 0);
+
+	tbb::parallel_for<unsigned>(0, tilesNumber, 1, [&](unsigned tileIndex)
+	{
+		const int tileX = (tileIndex % tilesPerRow) * tileSize;
+		const int tileY = (tileIndex / tilesPerRow) * tileSize;
+		const int tileEndX = std::min(tileX + static_cast<int>(tileSize), image.cols);
+		const int tileEndY = std::min(tileY + static_cast<int>(tileSize), image.rows);
+
+		/* Mean L, A, B values and L standard deviation of the tile. */
+		double sums[4] = { 0, 0, 0, 0 };
+
+		for (int y = tileY; y < tileEndY; ++y)
+		{
+			const PlanarImageRow pixels = image.pixelRow(y);
+
+			for (int x = tileX; x < tileEndX; ++x)
+			{
+				Vec3b pixelColor = pixels.pixel(x);
+
+				sums[0] += pixelColor.val[0];
+				sums[1] += pixelColor.val[1];
+				sums[2] += pixelColor.val[2];
+				sums[3] += pixelColor.val[0] * pixelColor.val[0];
+			}
+		}
+
+		const double tilePixels = (tileEndX - tileX) * (tileEndY - tileY);
+		double statistics[4];
+
+		statistics[0] = sums[0] / tilePixels;
+		statistics[1] = sums[1] / tilePixels;
+		statistics[2] = sums[2] / tilePixels;
+		statistics[3] = sqrt(std::max(0.0, sums[3] / tilePixels - statistics[0] * statistics[0]));
+
+		double difference = 0;
+
+		for (int n = 0; n < 4; ++n)
+			difference += fabs(statistics[n] - backgroundModel[4 * tileIndex + n]);
+
+		/* Changed tiles take the new values at once, so that a permanent
+		change stops triggering work after one frame; unchanged tiles slowly
+		follow illumination drifts. */
+		if (learnModel || difference > backgroundChangeThreshold)
+		{
+			changedTiles[tileIndex] = 1;
+
+			for (int n = 0; n < 4; ++n)
+				backgroundModel[4 * tileIndex + n] = statistics[n];
+		}
+		else
+			for (int n = 0; n < 4; ++n)
+				backgroundModel[4 * tileIndex + n] +=
+					backgroundLearningRate * (statistics[n] - backgroundModel[4 * tileIndex + n]);
+	});
+
+	buildChangedTilesIntegral();
+}
+
+void SLIC::hashChangedTiles(
+	const PlanarImage& image,
+	const bool         resetHashes)
+{
+	tilesPerRow = (image.cols + tileSize - 1) / tileSize;
+	tilesPerColumn = (image.rows + tileSize - 1) / tileSize;
+
+	const unsigned tilesNumber = tilesPerRow * tilesPerColumn;
+
+	/* Without previous hashes every tile counts as changed. */
+	const bool compareHashes = (resetHashes == false) && (tileHashes.size() == tilesNumber);
+
+	if (compareHashes == false)
+		tileHashes.assign(tilesNumber, 0);
+	changedTiles.assign(tilesNumber, 0);
+
+	tbb::parallel_for<unsigned>(0, tilesNumber, 1, [&](unsigned tileIndex)
+	{
+		const int tileX = (tileIndex % tilesPerRow) * tileSize;
+		const int tileY = (tileIndex / tilesPerRow) * tileSize;
+		const int tileEndX = std::min(tileX + static_cast<int>(tileSize), image.cols);
+		const int tileEndY = std::min(tileY + static_cast<int>(tileSize), image.rows);
+		const size_t rowBytes = (tileEndX - tileX) * image.elemSize();
+
+		/* Multiply-xorshift hash of the tile rows, read 8 bytes at a time.
+		The rows of planar frames are gathered first. */
+		unsigned long long hash = 0xcbf29ce484222325ULL ^ tileIndex;
+		std::vector<uchar> gatheredRow;
+
+		if (image.isInterleaved() == false)
+			gatheredRow.resize(rowBytes);
+
+		for (int y = tileY; y < tileEndY; ++y)
+		{
+			const uchar* row = image.row(0, y) + tileX * image.elemSize();
+			size_t n = 0;
+
+			if (image.isInterleaved() == false)
+			{
+				for (int x = tileX; x < tileEndX; ++x)
+					for (int channel = 0; channel < 3; ++channel)
+						gatheredRow[3 * (x - tileX) + channel] = image.value(channel, y, x);
+
+				row = gatheredRow.data();
+			}
+
+			for (; n + 8 <= rowBytes; n += 8)
+			{
+				unsigned long long word;
+				memcpy(&word, row + n, 8);
+
+				hash = (hash ^ word) * 0x9e3779b97f4a7c15ULL;
+				hash ^= hash >> 29;
+			}
+
+			unsigned long long tail = 0;
+			memcpy(&tail, row + n, rowBytes - n);
+
+			hash = (hash ^ tail ^ (static_cast<unsigned long long>(rowBytes - n) << 56)) * 0x9e3779b97f4a7c15ULL;
+			hash ^= hash >> 29;
+		}
+
+		if (compareHashes == false || hash != tileHashes[tileIndex])
+			changedTiles[tileIndex] = 1;
+
+		tileHashes[tileIndex] = hash;
+	});
+
+	buildChangedTilesIntegral();
+}
+
+void SLIC::buildChangedTilesIntegral()
+{
+	/* Build the summed area table of the changed tiles. */
+	changedTilesIntegral.assign((tilesPerRow + 1) * (tilesPerColumn + 1), 0);
+
+	for (unsigned tileY = 0; tileY < tilesPerColumn; ++tileY)
+		for (unsigned tileX = 0; tileX < tilesPerRow; ++tileX)
+			changedTilesIntegral[(tileY + 1) * (tilesPerRow + 1) + tileX + 1] =
+				changedTiles[tileY * tilesPerRow + tileX] +
+				changedTilesIntegral[tileY * (tilesPerRow + 1) + tileX + 1] +
+				changedTilesIntegral[(tileY + 1) * (tilesPerRow + 1) + tileX] -
+				changedTilesIntegral[tileY * (tilesPerRow + 1) + tileX];
+}
+
+bool SLIC::getClusterTiles(
+	const unsigned     centreIndex,
+	const PlanarImage& image,
+	unsigned&          firstTileX,
+	unsigned&          firstTileY,
+	unsigned&          lastTileX,
+	unsigned&          lastTileY)
+{
+	/* Search region of the cluster, clipped to the image. */
+	const int firstX = std::max(static_cast<int>(clusterCentres[5 * centreIndex + 3]) - static_cast<int>(samplingStep) - 1, 0);
+	const int firstY = std::max(static_cast<int>(clusterCentres[5 * centreIndex + 4]) - static_cast<int>(samplingStep) - 1, 0);
+	const int lastX = std::min(static_cast<int>(clusterCentres[5 * centreIndex + 3]) + static_cast<int>(samplingStep) + 1, image.cols - 1);
+	const int lastY = std::min(static_cast<int>(clusterCentres[5 * centreIndex + 4]) + static_cast<int>(samplingStep) + 1, image.rows - 1);
+
+	if (firstX > lastX || firstY > lastY)
+		return false;
+
+	firstTileX = firstX / tileSize;
+	firstTileY = firstY / tileSize;
+	lastTileX = lastX / tileSize + 1;
+	lastTileY = lastY / tileSize + 1;
+
+	return true;
+}
+
+void SLIC::selectActiveClusters(const PlanarImage& image)
+{
+	activeClusters.clear();
+	clusterIsActive.assign(clustersNumber, 0);
+
+	for (unsigned centreIndex = 0; centreIndex < clustersNumber; ++centreIndex)
+	{
+		unsigned firstTileX, firstTileY, lastTileX, lastTileY;
+
+		if (getClusterTiles(centreIndex, image, firstTileX, firstTileY, lastTileX, lastTileY) == false)
+			continue;
+
+		const unsigned changedTilesInRegion =
+			changedTilesIntegral[lastTileY * (tilesPerRow + 1) + lastTileX] -
+			changedTilesIntegral[firstTileY * (tilesPerRow + 1) + lastTileX] -
+			changedTilesIntegral[lastTileY * (tilesPerRow + 1) + firstTileX] +
+			changedTilesIntegral[firstTileY * (tilesPerRow + 1) + firstTileX];
+
+		if (changedTilesInRegion > 0)
+		{
+			activeClusters.push_back(centreIndex);
+			clusterIsActive[centreIndex] = 1;
+		}
+	}
+}
+
+void SLIC::iterateActiveClusters(
+	const PlanarImage&   image,
+	const unsigned       iterationNumber,
+	const double         errorThreshold,
+	SLICElaborationMode  SLICMode,
+	VideoElaborationMode videoMode)
+{
+	const unsigned activeClustersNumber = static_cast<unsigned>(activeClusters.size());
+
+	const unsigned tilesNumber = tilesPerRow * tilesPerColumn;
+
+	/* The content of the changed tiles is new, so their cached
+	contributions are recomputed in any case. */
+	if (tileContributionsValid == false || tileContributions.size() != tilesNumber)
+	{
+		tileContributions.assign(tilesNumber, std::vector<TileContribution>());
+		tileContributionsStale.assign(tilesNumber, 1);
+		tileContributionsValid = true;
+	}
+	else
+		for (unsigned tileIndex = 0; tileIndex < tilesNumber; ++tileIndex)
+			tileContributionsStale[tileIndex] |= changedTiles[tileIndex];
+
+	/* Tiles below the change threshold of the background model are not
+	the same pixels their contributions were summed on: the tiles searched
+	by the active clusters are summed again on this frame. Unchanged hashes
+	mean unchanged pixels, so CONTENT_HASHING keeps them. */
+	if (videoMode == STATIC_CAMERA)
+		for (const unsigned centreIndex : activeClusters)
+		{
+			unsigned firstTileX, firstTileY, lastTileX, lastTileY;
+
+			if (getClusterTiles(centreIndex, image, firstTileX, firstTileY, lastTileX, lastTileY))
+				for (unsigned tileY = firstTileY; tileY < lastTileY; ++tileY)
+					for (unsigned tileX = firstTileX; tileX < lastTileX; ++tileX)
+						tileContributionsStale[tileY * tilesPerRow + tileX] = 1;
+		}
+
+	/* Nothing moved: labels and centres of the previous frame are kept. */
+	if (activeClustersNumber == 0)
+	{
+		totalResidualError = 0;
+		return;
+	}
+
+	do
+	{
+		SLIC_BEGIN_ITERATION(instrumentation);
+		SLIC_TRACE_SCOPE("iteration", "iteration", iterationIndex);
+
+		{
+			SLIC_PHASE_TIMER(instrumentation, PHASE_ASSIGNMENT);
+
+			/* Reset the distance of the pixels which are going to be contended
+			again: the ones in changed tiles (all the clusters reaching them are
+			active) and the ones belonging to an active cluster. The distances
+			of the other pixels still refer to frozen centres and stay valid. */
+			tbb::parallel_for<unsigned>(0, activeClustersNumber, 1, [=](unsigned activeIndex)
+			{
+				const unsigned centreIndex = activeClusters[activeIndex];
+
+				for (int y = static_cast<int>(clusterCentres[5 * centreIndex + 4]) - samplingStep - 1;
+				y < clusterCentres[5 * centreIndex + 4] + samplingStep + 1; ++y)
+					for (int x = static_cast<int>(clusterCentres[5 * centreIndex + 3]) - samplingStep - 1;
+				x < clusterCentres[5 * centreIndex + 3] + samplingStep + 1; ++x)
+					if (x >= 0 && x < image.cols && y >= 0 && y < image.rows)
+					{
+						const int currentPixelCluster = pixelCluster[y * image.cols + x];
+
+						if (changedTiles[(y / tileSize) * tilesPerRow + x / tileSize] ||
+							currentPixelCluster == -1 || clusterIsActive[currentPixelCluster])
+							distanceFromClusterCentre[y * image.cols + x] = DBL_MAX;
+					}
+			});
+
+			scheduleClusterAssignment(image, &activeClusters, [=](unsigned centreIndex, int firstRow, int endRow)
+			{
+				assignClusterPixels(image, centreIndex, videoMode, firstRow, endRow);
+			});
+		}
+
+		/* Recompute the contributions of the tiles whose labels changed. */
+		{
+			SLIC_PHASE_TIMER(instrumentation, PHASE_ACCUMULATION);
+
+			tbb::parallel_for<unsigned>(0, tilesNumber, 1, [=](unsigned tileIndex)
+			{
+				if (tileContributionsStale[tileIndex])
+				{
+					accumulateTileContributions(image, tileIndex);
+					tileContributionsStale[tileIndex] = 0;
+				}
+			});
+		}
+
+		/* Each active cluster sums its own contributions, so no other
+		cluster's centre is touched. */
+		const double residualErrorSum = finishClusterCentres(image, &activeClusters, true);
+
+		/* Frozen clusters do not move, so only active clusters
+		contribute to the error. */
+		if (iterationIndex != 0)
+			totalResidualError = residualErrorSum / activeClustersNumber;
+
+		++iterationIndex;
+
+		SLIC_END_ITERATION(instrumentation);
+
+	} while (((totalResidualError > errorThreshold) && (SLICMode == ERROR_THRESHOLD)) ||
+		((iterationIndex < iterationNumber) && (SLICMode == FIXED_ITERATIONS)));
+}
+
+void SLIC::setStaticCameraParameters(
+	const unsigned tileSize,
+	const double   changeThreshold,
+	const double   learningRate)
+{
+	this->tileSize = std::max(tileSize, 1u);
+	this->backgroundChangeThreshold = changeThreshold;
+	this->backgroundLearningRate = learningRate;
+}
+
+unsigned SLIC::getActiveClustersNumber() const
+{
+	return backgroundFrozen ? static_cast<unsigned>(activeClusters.size()) : clustersNumber;
+}
+
+void SLIC::estimateGlobalMotion(
+	const PlanarImage& image,
+	int&               motionX,
+	int&               motionY)
+{
+	std::vector<double> columnProfile(image.cols, 0);
+	std::vector<double> rowProfile(image.rows, 0);
+
+	/* Average L value of each row and column. */
+	for (int y = 0; y < image.rows; ++y)
+	{
+		const PlanarImageRow pixels = image.pixelRow(y);
+
+		for (int x = 0; x < image.cols; ++x)
+		{
+			const uchar L = pixels.value(0, x);
+
+			columnProfile[x] += L;
+			rowProfile[y] += L;
+		}
+	}
+
+	for (int x = 0; x < image.cols; ++x)
+		columnProfile[x] /= image.rows;
+	for (int y = 0; y < image.rows; ++y)
+		rowProfile[y] /= image.cols;
+
+	/* Find the shift which best aligns each profile with the previous one,
+	measured as the mean absolute difference over the overlapping part. */
+	auto bestShift = [this](const std::vector<double>& profile, const std::vector<double>& previousProfile)
+	{
+		const int length = static_cast<int>(profile.size());
+		const int range = std::min(static_cast<int>(motionSearchRange), length / 2);
+
+		int    shift = 0;
+		double lowestDifference = DBL_MAX;
+
+		for (int candidate = -range; candidate <= range; ++candidate)
+		{
+			double difference = 0;
 
-		/* Initialize variables. */
-		this->pixelsNumber = image.rows * image.cols;
-		this->samplingStep = samplingStep;
-		this->spatialDistanceWeight = spatialDistanceWeight;
-		this->distanceFactor =
-			static_cast<double>(1.0 * spatialDistanceWeight * spatialDistanceWeight / (samplingStep * samplingStep));
-		this->errorThreshold = errorThreshold;
+			for (int n = std::max(0, candidate); n < std::min(length, length + candidate); ++n)
+				difference += fabs(profile[n] - previousProfile[n - candidate]);
 
-		/* Initialize the clusters and the distances matrices. */
-		pixelCluster.assign(pixelsNumber, -1);
-		//pixelReachedByClusters.assign(pixelsNumber, 255);
-		distanceFromClusterCentre.assign(pixelsNumber, DBL_MAX);
+			difference /= length - abs(candidate);
 
-		/* Initialize the centres matrix by sampling the image
-		at a regular step. */
-		for (int y = samplingStep; y < image.rows; y += samplingStep)
-			for (int x = samplingStep; x < image.cols; x += samplingStep)
+			/* Prefer smaller motions on ties. */
+			if (difference < lowestDifference ||
+				(difference == lowestDifference && abs(candidate) < abs(shift)))
 			{
-				/* Find the pixel with the lowest gradient in a 3x3 surrounding. */
-				Point lowestGradientPixel = findLowestGradient(image, Point(x, y));
-				Vec3b tempPixelColor = image.at<Vec3b>(lowestGradientPixel.y, lowestGradientPixel.x);
-
-				/* Insert a [L, A, B, x, y] centre in the centres vector. */
-				clusterCentres.push_back(tempPixelColor.val[0]);
-				clusterCentres.push_back(tempPixelColor.val[1]);
-				clusterCentres.push_back(tempPixelColor.val[2]);
-				clusterCentres.push_back(lowestGradientPixel.x);
-				clusterCentres.push_back(lowestGradientPixel.y);
-
-				/* During initialization, previous cluster centres matrix
-				is the same as cluster centres matrix.*/
-				previousClusterCentres.push_back(tempPixelColor.val[0]);
-				previousClusterCentres.push_back(tempPixelColor.val[1]);
-				previousClusterCentres.push_back(tempPixelColor.val[2]);
-				previousClusterCentres.push_back(lowestGradientPixel.x);
-				previousClusterCentres.push_back(lowestGradientPixel.y);
-
-				/* Initialize "pixel of same cluster" matrix. */
-				pixelsOfSameCluster.push_back(0);
-
-				/* Initialize residual error to be zero for each cluster
-				centre. */
-				residualError.push_back(0);
+				lowestDifference = difference;
+				shift = candidate;
 			}
+		}
 
-		/* Total number of clusters. */
-		this->clustersNumber = static_cast<unsigned>(pixelsOfSameCluster.size());
+		return shift;
+	};
 
-		///* Reset orphan pixels */
-		//if (videoMode == ADD_SUPERPIXELS || videoMode == ADD_SUPERPIXELS_NOISE)
-		//	orphanPixels = Mat(image.rows, image.cols, CV_8UC1, cv::Scalar(255));
+	motionX = 0;
+	motionY = 0;
+
+	if (previousColumnProfile.size() == columnProfile.size() && previousRowProfile.size() == rowProfile.size())
+	{
+		motionX = bestShift(columnProfile, previousColumnProfile);
+		motionY = bestShift(rowProfile, previousRowProfile);
 	}
-	/* Add Gaussian noise if requested. */
-	else if ((videoMode == NOISE) || (videoMode == KEY_FRAMES_NOISE) || (videoMode == ADD_SUPERPIXELS_NOISE))
+
+	previousColumnProfile.swap(columnProfile);
+	previousRowProfile.swap(rowProfile);
+}
+
+void SLIC::propagateSuperpixels(
+	const PlanarImage& image,
+	const int          motionX,
+	const int          motionY)
+{
+	std::vector<int> warpedPixelCluster(pixelsNumber);
+
+	/* Move the labels with the frame content; pixels entering the frame
+	take the label of the nearest pixel on the border. */
+	tbb::parallel_for(0, image.rows, 1, [&](int y)
 	{
-		/* Random noise generator. */
-		RandNormal randomGen(0.0, GaussianStdDev);
+		const int sourceY = std::min(std::max(y - motionY, 0), image.rows - 1);
 
-		/* Add some gaussian noise to position. */
-		/* Color should be kept equal: we look for a similar color in the surroundings. */
-		for (unsigned n = 0; n < clustersNumber; ++n)
+		for (int x = 0; x < image.cols; ++x)
 		{
-			clusterCentres[5 * n + 3] += randomGen();
-			clusterCentres[5 * n + 4] += randomGen();
+			const int sourceX = std::min(std::max(x - motionX, 0), image.cols - 1);
+
+			warpedPixelCluster[y * image.cols + x] = pixelCluster[sourceY * image.cols + sourceX];
 		}
+	});
+
+	pixelCluster.swap(warpedPixelCluster);
+
+	/* Move the centres as well, keeping them inside the frame. */
+	for (unsigned centreIndex = 0; centreIndex < clustersNumber; ++centreIndex)
+	{
+		clusterCentres[5 * centreIndex + 3] =
+			std::min(std::max(clusterCentres[5 * centreIndex + 3] + motionX, 0.0), image.cols - 1.0);
+		clusterCentres[5 * centreIndex + 4] =
+			std::min(std::max(clusterCentres[5 * centreIndex + 4] + motionY, 0.0), image.rows - 1.0);
 	}
 
-	/* Initialize total residual error for each frame. */
-	this->totalResidualError = DBL_MAX;
+	/* Only pixels on a boundary between superpixels may have been
+	wrongly warped: give them the nearest of the clusters around them. */
+	for (unsigned pass = 0; pass < propagationRefinements; ++pass)
+	{
+		tbb::parallel_for(0, image.rows, 1, [&](int y)
+		{
+			for (int x = 0; x < image.cols; ++x)
+			{
+				const int currentPixelCluster = pixelCluster[y * image.cols + x];
 
-	/* Reset orphan pixels */
-	if (videoMode == ADD_SUPERPIXELS || videoMode == ADD_SUPERPIXELS_NOISE)
-		pixelReachedByClusters.assign(pixelsNumber, 255);
+				warpedPixelCluster[y * image.cols + x] = currentPixelCluster;
 
-	//if (videoMode == ADD_SUPERPIXELS || videoMode == ADD_SUPERPIXELS_NOISE)
-	////	orphanPixels = Mat(image.rows, image.cols, CV_8UC1, cv::Scalar(255));
-	//	orphanPixels.setTo(cv::Scalar(255));
-}
+				bool boundaryPixel = false;
 
-Point SLIC::findLowestGradient(
-	const cv::Mat&   image,
-	const cv::Point& centre)
-{
-	unsigned lowestGradient = UINT_MAX;
-	Point lowestGradientPoint = Point(centre.x, centre.y);
+				for (int tempY = std::max(y - 1, 0); tempY <= std::min(y + 1, image.rows - 1); ++tempY)
+					for (int tempX = std::max(x - 1, 0); tempX <= std::min(x + 1, image.cols - 1); ++tempX)
+						if (pixelCluster[tempY * image.cols + tempX] != currentPixelCluster)
+							boundaryPixel = true;
 
-	for (int y = centre.y - 1; y <= centre.y + 1 && y < image.rows - 1; ++y)
-		for (int x = centre.x - 1; x <= centre.x + 1 && x < image.cols - 1; ++x)
+				if (boundaryPixel == false)
+					continue;
+
+				Vec3b  pixelColor = image.pixel(y, x);
+				int    nearestCluster = currentPixelCluster;
+				double lowestDistance = (currentPixelCluster >= 0) ?
+					computeDistance(currentPixelCluster, Point(x, y), pixelColor) : DBL_MAX;
+
+				for (int tempY = std::max(y - 1, 0); tempY <= std::min(y + 1, image.rows - 1); ++tempY)
+					for (int tempX = std::max(x - 1, 0); tempX <= std::min(x + 1, image.cols - 1); ++tempX)
+					{
+						const int neighborCluster = pixelCluster[tempY * image.cols + tempX];
+
+						if (neighborCluster >= 0 && neighborCluster != nearestCluster)
+						{
+							double tempDistance = computeDistance(neighborCluster, Point(x, y), pixelColor);
+
+							if (tempDistance < lowestDistance)
+							{
+								lowestDistance = tempDistance;
+								nearestCluster = neighborCluster;
+							}
+						}
+					}
+
+				warpedPixelCluster[y * image.cols + x] = nearestCluster;
+			}
+		});
+
+		pixelCluster.swap(warpedPixelCluster);
+	}
+
+	/* Recompute the centres from the propagated labels, so that their
+	colours and sizes describe this frame. Clusters left without pixels
+	keep their moved centre. */
+	std::vector<double> centreSums(5 * clustersNumber, 0);
+	pixelsOfSameCluster.assign(clustersNumber, 0);
+
+	for (int y = 0; y < image.rows; ++y)
+	{
+		const PlanarImageRow pixels = image.pixelRow(y);
+
+		for (int x = 0; x < image.cols; ++x)
 		{
-			/* Exclude pixels on borders. */
-			if (x < 1 || y < 1)
+			const int currentPixelCluster = pixelCluster[y * image.cols + x];
+
+			if (currentPixelCluster == -1)
 				continue;
 
-			/* Compute horizontal and vertical gradients and keep track
-			of the minimum. */
-			unsigned tempGradient =
-				(image.at<Vec3b>(y, x + 1).val[0] - image.at<Vec3b>(y, x - 1).val[0]) *
-				(image.at<Vec3b>(y, x + 1).val[0] - image.at<Vec3b>(y, x - 1).val[0]) +
-				(image.at<Vec3b>(y - 1, x).val[0] - image.at<Vec3b>(y + 1, x).val[0]) *
-				(image.at<Vec3b>(y - 1, x).val[0] - image.at<Vec3b>(y + 1, x).val[0]);
+			Vec3b pixelColor = pixels.pixel(x);
 
-			if (tempGradient < lowestGradient)
-			{
-				lowestGradient = tempGradient;
-				lowestGradientPoint.x = x;
-				lowestGradientPoint.y = y;
-			}
+			centreSums[5 * currentPixelCluster] += pixelColor.val[0];
+			centreSums[5 * currentPixelCluster + 1] += pixelColor.val[1];
+			centreSums[5 * currentPixelCluster + 2] += pixelColor.val[2];
+			centreSums[5 * currentPixelCluster + 3] += x;
+			centreSums[5 * currentPixelCluster + 4] += y;
+
+			++pixelsOfSameCluster[currentPixelCluster];
 		}
+	}
 
-	return lowestGradientPoint;
+	for (unsigned centreIndex = 0; centreIndex < clustersNumber; ++centreIndex)
+	{
+		if (pixelsOfSameCluster[centreIndex] != 0)
+			for (int n = 0; n < 5; ++n)
+				clusterCentres[5 * centreIndex + n] = centreSums[5 * centreIndex + n] / pixelsOfSameCluster[centreIndex];
+
+		for (int n = 0; n < 5; ++n)
+			previousClusterCentres[5 * centreIndex + n] = clusterCentres[5 * centreIndex + n];
+	}
+
+	/* No iteration has been performed on this frame. */
+	totalResidualError = 0;
 }
 
-double SLIC::computeDistance(
-	const int        centreIndex,
-	const cv::Point& pixelPosition,
-	const cv::Vec3b& pixelColor)
+void SLIC::setPropagationParameters(
+	const unsigned refinementPasses,
+	const unsigned searchRange)
 {
-	/* Compute the color distance between two pixels. */
-	double colorDistance =
-		(clusterCentres[5 * centreIndex] - pixelColor.val[0]) *
-		(clusterCentres[5 * centreIndex] - pixelColor.val[0]) +
-		(clusterCentres[5 * centreIndex + 1] - pixelColor.val[1]) *
-		(clusterCentres[5 * centreIndex + 1] - pixelColor.val[1]) +
-		(clusterCentres[5 * centreIndex + 2] - pixelColor.val[2]) *
-		(clusterCentres[5 * centreIndex + 2] - pixelColor.val[2]);
-
-	/* Compute the spatial distance between two pixels. */
-	double spaceDistance =
-		(clusterCentres[5 * centreIndex + 3] - pixelPosition.x) *
-		(clusterCentres[5 * centreIndex + 3] - pixelPosition.x) +
-		(clusterCentres[5 * centreIndex + 4] - pixelPosition.y) *
-		(clusterCentres[5 * centreIndex + 4] - pixelPosition.y);
+	this->propagationRefinements = refinementPasses;
+	this->motionSearchRange = searchRange;
+}
 
-	/* Compute total distance between two pixels using the formula
-	described in the paper. */
-	return colorDistance + distanceFactor * spaceDistance;
+SuperpixelsPath SLIC::getLastFramePath() const
+{
+	return lastFramePath;
 }
 
-void SLIC::createSuperpixels(
-	const cv::Mat&       image,
-	const unsigned       samplingStep,
-	const unsigned       spatialDistanceWeight,
+void SLIC::iterateAllClusters(
+	const PlanarImage&   image,
 	const unsigned       iterationNumber,
 	const double         errorThreshold,
 	SLICElaborationMode  SLICMode,
-	VideoElaborationMode videoMode,
-	const unsigned       keyFramesRatio,
-	const double         GaussianStdDev,
-	const bool           connectedFrames)
+	VideoElaborationMode videoMode)
 {
-	/* Initialize algorithm data. */
-	initializeSLICData(
-		image, samplingStep, spatialDistanceWeight, errorThreshold,
-		videoMode, keyFramesRatio, GaussianStdDev, connectedFrames);
-	iterationIndex = 0;
 	bool go = false;
 	/* Repeat next steps until error is lower than the threshold or
 	until the number of iteration is reached. */
@@ -311,142 +2346,115 @@ void SLIC::createSuperpixels(
 	((iterationIndex < iterationNumber) && (SLICMode == FIXED_ITERATIONS)); ++iterationIndex)*/
 	do
 	{
-		/* Reset distance values. */
-		distanceFromClusterCentre.assign(pixelsNumber, DBL_MAX);
-
-		tbb::parallel_for<unsigned>(0, clustersNumber, 1, [=](unsigned centreIndex)
+		SLIC_BEGIN_ITERATION(instrumentation);
+		SLIC_TRACE_SCOPE("iteration", "iteration", iterationIndex);
+
+		/* Early iterations evaluate only a subset of the pixels
+		(1/4, then 1/2); the last iteration is always complete. */
+		samplingLevel = 0;
+		if (iterationIndex < subsampledIterations &&
+			(SLICMode == ERROR_THRESHOLD || iterationIndex + 1 < iterationNumber))
+			samplingLevel = subsampledIterations - iterationIndex;
+		samplingOffset = iterationIndex + framesNumber;
+
+		const int sampleWeight = 1 << samplingLevel;
+
+		/* Integer kernels on 8-bit input, same steps as below. */
+		if (arithmetic == FIXED_POINT)
+			updateCentresFixedPoint(image, videoMode, sampleWeight);
+		/* Lock-free assignment on packed per-pixel words. */
+		else if (pixelStateLayout == PACKED_WORD)
+			updateCentresPacked(image, videoMode, sampleWeight);
+		else
 		{
-			/* For each cluster, look for pixels in a 2 x step by 2 x step region only. */
-			for (int y = static_cast<int>(clusterCentres[5 * centreIndex + 4]) - samplingStep - 1;
-			y < clusterCentres[5 * centreIndex + 4] + samplingStep + 1; ++y)
-				for (int x = static_cast<int>(clusterCentres[5 * centreIndex + 3]) - samplingStep - 1;
-			x < clusterCentres[5 * centreIndex + 3] + samplingStep + 1; ++x)
 			{
-				/* Verify that neighbor pixel is within the image boundaries. */
-				if (x >= 0 && x < image.cols && y >= 0 && y < image.rows)
-				{
-					Vec3b pixelColor = image.at<Vec3b>(y, x);
-
-					double tempDistance =
-						computeDistance(centreIndex, Point(x, y), pixelColor);
+				SLIC_PHASE_TIMER(instrumentation, PHASE_ASSIGNMENT);
 
-					/* This pixel has been searched */
-					if (videoMode == ADD_SUPERPIXELS || videoMode == ADD_SUPERPIXELS_NOISE)
-						pixelReachedByClusters[y * image.cols + x] = 0;
-					//orphanPixels.at<uchar>(y, x) = 0;
+				/* Reset distance values. */
+				distanceFromClusterCentre.assign(pixelsNumber, DBL_MAX);
 
-					/* Update pixel's cluster if this distance is smaller
-					than pixel's previous distance. */
-					if (tempDistance < distanceFromClusterCentre[y * image.cols + x])
+				if (assignmentSchedule == PIXEL_CENTRIC)
+					assignPixelsFromCentres(image, videoMode);
+				else if (assignmentSchedule == BAND_SWEEP)
+					assignClustersInBands(image, videoMode);
+				else
+					scheduleClusterAssignment(image, nullptr, [=](unsigned centreIndex, int firstRow, int endRow)
 					{
-						distanceFromClusterCentre[y * image.cols + x] = tempDistance;
-						pixelCluster[y * image.cols + x] = centreIndex;
-					}
-				}
+						assignClusterPixels(image, centreIndex, videoMode, firstRow, endRow);
+					});
 			}
-		});
-
-		/* Reset centres values and the number of pixel
-		per cluster to zero.
-		/*tbb::parallel_for<unsigned>(0, clustersNumber, 1, [=](unsigned centreIndex)
-		{
-		clusterCentres[5 * centreIndex] = 0;
-		clusterCentres[5 * centreIndex + 1] = 0;
-		clusterCentres[5 * centreIndex + 2] = 0;
-		clusterCentres[5 * centreIndex + 3] = 0;
-		clusterCentres[5 * centreIndex + 4] = 0;
-
-		pixelsOfSameCluster[centreIndex] = 0;
-		});*/
 
-		/* Reset centres values and the number of pixel
-		per cluster to zero. */
-		clusterCentres.assign(clustersNumber * 5, 0);
-		pixelsOfSameCluster.assign(clustersNumber, 0);
+			SLIC_PHASE_TIMER(instrumentation, PHASE_ACCUMULATION);
 
-		/* Compute the new cluster centres. */
-		for (int y = 0; y < image.rows; ++y)
-			for (int x = 0; x < image.cols; ++x)
+			/* Reset centres values and the number of pixel
+			per cluster to zero.
+			/*tbb::parallel_for<unsigned>(0, clustersNumber, 1, [=](unsigned centreIndex)
 			{
-				int currentPixelCluster = pixelCluster[y * image.cols + x];
+			clusterCentres[5 * centreIndex] = 0;
+			clusterCentres[5 * centreIndex + 1] = 0;
+			clusterCentres[5 * centreIndex + 2] = 0;
+			clusterCentres[5 * centreIndex + 3] = 0;
+			clusterCentres[5 * centreIndex + 4] = 0;
+
+			pixelsOfSameCluster[centreIndex] = 0;
+			});*/
+
+			/* Reset centres values and the number of pixel
+			per cluster to zero. */
+			clusterCentres.assign(clustersNumber * 5, 0);
+			pixelsOfSameCluster.assign(clustersNumber, 0);
+
+			/* Compute the new cluster centres. */
+			for (int y = 0; y < image.rows; ++y)
+			{
+				const PlanarImageRow pixels = image.pixelRow(y);
 
-				/* Verify if current pixel belongs to a cluster. */
-				if (currentPixelCluster != -1)
+				for (int x = 0; x < image.cols; ++x)
 				{
-					/* Sum the information of pixels of the same
-					cluster for future centre recalculation. */
-					Vec3b pixelColor = image.at<Vec3b>(y, x);
-
-					clusterCentres[5 * currentPixelCluster] += pixelColor.val[0];
-					clusterCentres[5 * currentPixelCluster + 1] += pixelColor.val[1];
-					clusterCentres[5 * currentPixelCluster + 2] += pixelColor.val[2];
-					clusterCentres[5 * currentPixelCluster + 3] += x;
-					clusterCentres[5 * currentPixelCluster + 4] += y;
+					int currentPixelCluster = pixelCluster[y * image.cols + x];
 
-					pixelsOfSameCluster[currentPixelCluster] += 1;
+					/* Verify if current pixel belongs to a cluster and has been
+					evaluated in this iteration. */
+					if (currentPixelCluster != -1 && isPixelSampled(x, y))
+					{
+						/* Sum the information of pixels of the same
+						cluster for future centre recalculation. Each evaluated
+						pixel stands for the ones skipped around it. */
+						Vec3b pixelColor = pixels.pixel(x);
+
+						clusterCentres[5 * currentPixelCluster] += sampleWeight * pixelColor.val[0];
+						clusterCentres[5 * currentPixelCluster + 1] += sampleWeight * pixelColor.val[1];
+						clusterCentres[5 * currentPixelCluster + 2] += sampleWeight * pixelColor.val[2];
+						clusterCentres[5 * currentPixelCluster + 3] += sampleWeight * x;
+						clusterCentres[5 * currentPixelCluster + 4] += sampleWeight * y;
+
+						pixelsOfSameCluster[currentPixelCluster] += sampleWeight;
+					}
 				}
 			}
+		}
 
-		/* Normalize the clusters' centres. */
-		tbb::parallel_for<unsigned>(0, clustersNumber, 1, [=](unsigned centreIndex)
-		{
-			/* Avoid empty clusters, if there are any. */
-			if (pixelsOfSameCluster[centreIndex] != 0)
-			{
-				clusterCentres[5 * centreIndex] /= pixelsOfSameCluster[centreIndex];
-				clusterCentres[5 * centreIndex + 1] /= pixelsOfSameCluster[centreIndex];
-				clusterCentres[5 * centreIndex + 2] /= pixelsOfSameCluster[centreIndex];
-				clusterCentres[5 * centreIndex + 3] /= pixelsOfSameCluster[centreIndex];
-				clusterCentres[5 * centreIndex + 4] /= pixelsOfSameCluster[centreIndex];
-			}
-		});
+		/* Normalize the clusters' centres and compute their residual
+		errors in one pass. */
+		const double residualErrorSum = finishClusterCentres(image, nullptr, false);
 
 		/* Skip error calculation if this is the first iteration,
-		meaning this is a new frame in the video. */
-		if (iterationIndex == 0)
-			for (unsigned centreIndex = 0; centreIndex < 5 * clustersNumber; ++centreIndex)
-			{
-				/* Update previous centres matrix. */
-				previousClusterCentres[centreIndex] = clusterCentres[centreIndex];
-			}
-		else
-		{
-			/* Compute residual error. */
-			tbb::parallel_for<unsigned>(0, clustersNumber, 1, [=](unsigned centreIndex)
-			{
-				/* Calculate residual error for each cluster centre. */
-				residualError[centreIndex] = sqrt(
-					(clusterCentres[5 * centreIndex + 4] - previousClusterCentres[5 * centreIndex + 4]) *
-					(clusterCentres[5 * centreIndex + 4] - previousClusterCentres[5 * centreIndex + 4]) +
-					(clusterCentres[5 * centreIndex + 3] - previousClusterCentres[5 * centreIndex + 3]) *
-					(clusterCentres[5 * centreIndex + 3] - previousClusterCentres[5 * centreIndex + 3]));
-
-				/* Update previous centres matrix. */
-				previousClusterCentres[5 * centreIndex] = clusterCentres[5 * centreIndex];
-				previousClusterCentres[5 * centreIndex + 1] = clusterCentres[5 * centreIndex + 1];
-				previousClusterCentres[5 * centreIndex + 2] = clusterCentres[5 * centreIndex + 2];
-				previousClusterCentres[5 * centreIndex + 3] = clusterCentres[5 * centreIndex + 3];
-				previousClusterCentres[5 * centreIndex + 4] = clusterCentres[5 * centreIndex + 4];
-			});
-
-			/* Compute total residual error by averaging all clusters' errors. */
-			totalResidualError = 0;
-
-			for (unsigned centreIndex = 0; centreIndex < clustersNumber; ++centreIndex)
-				totalResidualError += residualError[centreIndex];
-
-			totalResidualError /= clustersNumber;
-		}
+		meaning this is a new frame in the video. Otherwise compute total
+		residual error by averaging all clusters' errors. */
+		if (iterationIndex != 0)
+			totalResidualError = residualErrorSum / clustersNumber;
 
 		/* Blob Detector */
 		/* At the last iteration it finds orphan pixels and it creates a new superpixel to fix it */
-		if ((videoMode == ADD_SUPERPIXELS || videoMode == ADD_SUPERPIXELS_NOISE)
+		if ((videoMode == ADD_SUPERPIXELS || videoMode == ADD_SUPERPIXELS_NOISE) && samplingLevel == 0
 			&& (((totalResidualError < errorThreshold) && (SLICMode == ERROR_THRESHOLD)) ||
 				((iterationIndex >= iterationNumber-1) && (SLICMode == FIXED_ITERATIONS)))
 			&& (std::any_of(pixelReachedByClusters.begin(),
 				pixelReachedByClusters.end(),
 				[](uchar u) {return u == 255; })))
 		{
+			SLIC_PHASE_TIMER(instrumentation, PHASE_ORPHANS);
+
 			/* Image containing orphan pixels */
 			Mat orphanPixels = Mat(image.rows, image.cols, CV_8UC1, pixelReachedByClusters.data());
 
@@ -536,6 +2544,12 @@ void SLIC::createSuperpixels(
 				/* update number of clusters */
 				clustersNumber += 1;
 
+				/* The new cluster is a new superpixel. */
+				addClusterIdentity(clustersNumber - 1);
+
+				/* Until the next rebuild, the grid also finds the new centres. */
+				centresGrid.insert(clustersNumber - 1, mu.m10 / mu.m00, mu.m01 / mu.m00);
+
 				//numberOfCentres += 1;
 				//circle(colouredOrphanPixels, Point2f(static_cast<float>(mu.m10 / mu.m00),
 				//	static_cast<float>(mu.m01 / mu.m00)), 1, Scalar(255, 255, 0), 2);
@@ -555,15 +2569,156 @@ void SLIC::createSuperpixels(
 
 		++iterationIndex;
 
+		SLIC_END_ITERATION(instrumentation);
+
+		if (iterationCallback)
+			iterationCallback(iterationIndex, clusterCentres);
+
 	} while ((((totalResidualError > errorThreshold) && (SLICMode == ERROR_THRESHOLD)) ||
-		((iterationIndex < iterationNumber) && (SLICMode == FIXED_ITERATIONS))) && go);
+		((iterationIndex < iterationNumber) && (SLICMode == FIXED_ITERATIONS)) ||
+		/* Never stop on a subsampled iteration. */
+		(samplingLevel > 0)) && go);
+
+	samplingLevel = 0;
+
+	/* The frozen paths compare new distances with these ones. */
+	if ((arithmetic == FIXED_POINT || pixelStateLayout == PACKED_WORD) &&
+		(videoMode == STATIC_CAMERA || videoMode == CONTENT_HASHING))
+		distanceFromClusterCentre.resize(pixelsNumber);
+
+	if (arithmetic == FIXED_POINT && (videoMode == STATIC_CAMERA || videoMode == CONTENT_HASHING))
+		for (unsigned n = 0; n < pixelsNumber; ++n)
+			distanceFromClusterCentre[n] = (fixedDistanceFromClusterCentre[n] == INT_MAX) ?
+				DBL_MAX : fixedDistanceFromClusterCentre[n] / 256.0;
+	else if (pixelStateLayout == PACKED_WORD && (videoMode == STATIC_CAMERA || videoMode == CONTENT_HASHING))
+		for (unsigned n = 0; n < pixelsNumber; ++n)
+		{
+			const unsigned long long word = packedPixelState[n].load(std::memory_order_relaxed);
+			const unsigned distanceBits = static_cast<unsigned>(word >> 32);
+			float distance;
+
+			memcpy(&distance, &distanceBits, sizeof(distance));
+			distanceFromClusterCentre[n] = (word == ULLONG_MAX) ? DBL_MAX : distance;
+		}
+}
+
+void SLIC::createSuperpixels(
+	const cv::Mat&       image,
+	const unsigned       samplingStep,
+	const unsigned       spatialDistanceWeight,
+	const unsigned       iterationNumber,
+	const double         errorThreshold,
+	SLICElaborationMode  SLICMode,
+	VideoElaborationMode videoMode,
+	const unsigned       keyFramesRatio,
+	const double         GaussianStdDev,
+	const bool           connectedFrames)
+{
+	createSuperpixels(
+		PlanarImage::fromMat(image), samplingStep, spatialDistanceWeight, iterationNumber, errorThreshold,
+		SLICMode, videoMode, keyFramesRatio, GaussianStdDev, connectedFrames);
+}
+
+void SLIC::createSuperpixels(
+	const PlanarImage&   image,
+	const unsigned       samplingStep,
+	const unsigned       spatialDistanceWeight,
+	const unsigned       iterationNumber,
+	const double         errorThreshold,
+	SLICElaborationMode  SLICMode,
+	VideoElaborationMode videoMode,
+	const unsigned       keyFramesRatio,
+	const double         GaussianStdDev,
+	const bool           connectedFrames)
+{
+	SLIC_BEGIN_FRAME(instrumentation, totalFramesNumber, static_cast<unsigned long long>(image.rows) * image.cols);
+	SLIC_TRACE_SCOPE("frame", "frame", totalFramesNumber);
+
+	/* Initialize algorithm data. */
+	const bool initializedFromScratch = initializeSLICData(
+		image, samplingStep, spatialDistanceWeight, errorThreshold,
+		videoMode, keyFramesRatio, GaussianStdDev, connectedFrames);
+	iterationIndex = 0;
+
+	/* Only filled when this frame sweeps bands. */
+	bandSweepStatistics = BandSweepStatistics();
+
+	/* The motion is estimated on every frame, so that the profiles of the
+	previous frame are always available. */
+	int motionX = 0;
+	int motionY = 0;
+
+	if (videoMode == KEY_FRAMES_PROPAGATION)
+		estimateGlobalMotion(image, motionX, motionY);
+
+	/* With a static camera, compare the frame with the background model (or
+	the tile hashes with the previous ones) and iterate only the clusters
+	reaching the tiles which changed. */
+	if (videoMode == STATIC_CAMERA)
+		detectChangedTiles(image, initializedFromScratch);
+	else if (videoMode == CONTENT_HASHING)
+		hashChangedTiles(image, initializedFromScratch);
+
+	if ((videoMode == STATIC_CAMERA || videoMode == CONTENT_HASHING) && initializedFromScratch == false)
+	{
+		lastFramePath = FROZEN_BACKGROUND;
+		backgroundFrozen = true;
+
+		/* The previous frame ran in another mode, without double distances. */
+		if (distanceFromClusterCentre.size() != pixelsNumber)
+			distanceFromClusterCentre.assign(pixelsNumber, DBL_MAX);
+
+		selectActiveClusters(image);
+		iterateActiveClusters(image, iterationNumber, errorThreshold, SLICMode, videoMode);
+	}
+	/* Between key frames, the superpixels of the previous frame are propagated. */
+	else if (videoMode == KEY_FRAMES_PROPAGATION && initializedFromScratch == false &&
+		(keyFramesRatio == 0 || framesNumber % keyFramesRatio != 0))
+	{
+		lastFramePath = LABELS_PROPAGATION;
+		backgroundFrozen = false;
+		tileContributionsValid = false;
+		propagateSuperpixels(image, motionX, motionY);
+	}
+	else
+	{
+		/* Labels are going to change everywhere. */
+		lastFramePath = FULL_ITERATIONS;
+		backgroundFrozen = false;
+		tileContributionsValid = false;
+
+		/* Centres coming from the pyramid only need to be refined. */
+		const unsigned fullResolutionIterations =
+			(initializedFromScratch && centresSeededFromPyramid) ? pyramidFinalIterations : iterationNumber;
+
+		iterateAllClusters(image, fullResolutionIterations, errorThreshold, SLICMode, videoMode);
+	}
+
+	/* Match the new clusters with the superpixels existing before
+	re-initialization, so that identities survive key frames. */
+	if (identityMatchingPending)
+		matchClusterIdentities(image);
+
+	/* Bring the cluster order back to spatial order. */
+	lastClusterPermutation.clear();
+
+	if (relabellingPeriod != 0 && (totalFramesNumber + 1) % relabellingPeriod == 0)
+		relabelClustersInMortonOrder();
 
 	/* Another frame was processed. */
 	++framesNumber;
+	++totalFramesNumber;
 }
 
 void SLIC::enforceConnectivity(const cv::Mat image)
 {
+	enforceConnectivity(PlanarImage::fromMat(image));
+}
+
+void SLIC::enforceConnectivity(const PlanarImage& image)
+{
+	SLIC_PHASE_TIMER(instrumentation, PHASE_CONNECTIVITY);
+
 	int adjacentCluster = 0;
 
 	/* Average number of pixels contained in any expected cluster. */
@@ -631,6 +2786,9 @@ void SLIC::enforceConnectivity(const cv::Mat image)
 	for (unsigned n = 0; n < pixelsNumber; ++n)
 		pixelCluster[n] = newPixelCluster[n];
 
+	/* Labels changed outside the frozen path. */
+	tileContributionsValid = false;
+
 	/* After enforcing connectivity, cluster centres must be recalculated. */
 	/* Reset centres values and the number of pixel
 	per cluster to zero. */
@@ -647,6 +2805,9 @@ void SLIC::enforceConnectivity(const cv::Mat image)
 
 	/* Compute the new cluster centres. */
 	for (int y = 0; y < image.rows; ++y)
+	{
+		const PlanarImageRow pixels = image.pixelRow(y);
+
 		for (int x = 0; x < image.cols; ++x)
 		{
 			int currentPixelCluster = pixelCluster[y * image.cols + x];
@@ -656,7 +2817,7 @@ void SLIC::enforceConnectivity(const cv::Mat image)
 			{
 				/* Sum the information of pixels of the same
 				cluster for future centre recalculation. */
-				Vec3b pixelColor = image.at<Vec3b>(y, x);
+				Vec3b pixelColor = pixels.pixel(x);
 
 				clusterCentres[5 * currentPixelCluster] += pixelColor.val[0];
 				clusterCentres[5 * currentPixelCluster + 1] += pixelColor.val[1];
@@ -667,6 +2828,7 @@ void SLIC::enforceConnectivity(const cv::Mat image)
 				pixelsOfSameCluster[currentPixelCluster] += 1;
 			}
 		}
+	}
 
 	/* Normalize the clusters' centres. */
 	tbb::parallel_for<unsigned>(0, clustersNumber, 1, [=](unsigned centreIndex)
@@ -777,13 +2939,8 @@ void SLIC::drawClusterCentres(
 	});
 }
 
-void SLIC::drawInformation(
-	cv::Mat&       image,
-	const unsigned totalFrames,
-	const unsigned executionTimeInMilliseconds)
+void SLIC::updateStatistics(const unsigned executionTimeInMilliseconds)
 {
-	std::ostringstream stringStream;
-
 	if (totalResidualError < minError)
 		minError = totalResidualError;
 	if (totalResidualError > maxError)
@@ -797,6 +2954,18 @@ void SLIC::drawInformation(
 	if (executionTimeInMilliseconds > maxExecutionTime)
 		maxExecutionTime = executionTimeInMilliseconds;
 
+	averageExecutionTime += executionTimeInMilliseconds;
+	averageIterations += iterationIndex;
+	averageError += totalResidualError;
+}
+
+void SLIC::drawInformation(
+	cv::Mat&       image,
+	const unsigned totalFrames,
+	const unsigned executionTimeInMilliseconds)
+{
+	std::ostringstream stringStream;
+
 	rectangle(image, Point(0, 0), Point(260, 320), CV_RGB(255, 255, 255), CV_FILLED);
 
 	stringStream << "Frame: " << framesNumber << " (" << totalFrames << " total)";
@@ -829,7 +2998,7 @@ void SLIC::drawInformation(
 		FONT_HERSHEY_COMPLEX_SMALL, 0.8, CV_RGB(0, 0, 0), 1, CV_AA);
 
 	stringStream.str("");
-	stringStream << "Exe. time avg.: " << (averageExecutionTime += executionTimeInMilliseconds) / framesNumber << " ms";
+	stringStream << "Exe. time avg.: " << averageExecutionTime / framesNumber << " ms";
 	putText(image, stringStream.str(), Point(5, 140),
 		FONT_HERSHEY_COMPLEX_SMALL, 0.8, CV_RGB(0, 0, 0), 1, CV_AA);
 
@@ -849,7 +3018,7 @@ void SLIC::drawInformation(
 		FONT_HERSHEY_COMPLEX_SMALL, 0.8, CV_RGB(0, 0, 0), 1, CV_AA);
 
 	stringStream.str("");
-	stringStream << "Iterations avg.: " << (averageIterations += iterationIndex) / framesNumber;
+	stringStream << "Iterations avg.: " << averageIterations / framesNumber;
 	putText(image, stringStream.str(), Point(5, 220),
 		FONT_HERSHEY_COMPLEX_SMALL, 0.8, CV_RGB(0, 0, 0), 1, CV_AA);
 
@@ -869,7 +3038,7 @@ void SLIC::drawInformation(
 		FONT_HERSHEY_COMPLEX_SMALL, 0.8, CV_RGB(0, 0, 0), 1, CV_AA);
 
 	stringStream.str("");
-	stringStream << "Error avg.: " << (averageError += totalResidualError) / framesNumber;
+	stringStream << "Error avg.: " << averageError / framesNumber;
 	putText(image, stringStream.str(), Point(5, 300),
 		FONT_HERSHEY_COMPLEX_SMALL, 0.8, CV_RGB(0, 0, 0), 1, CV_AA);
 }
\ No newline at end of file
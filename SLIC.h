@@ -23,10 +23,23 @@
 #include <boost/chrono.hpp>
 
 #include <vector>
+#include <unordered_map>
+#include <atomic>
+#include <memory>
+#include <functional>
 
 /*Random Generator library*/
 #include "RandomGen.h"
 
+/* Planar view of the frames. */
+#include "PlanarImage.h"
+
+/* Spatial index of the cluster centres. */
+#include "CentreGridIndex.h"
+
+/* Phase timing, compiled out unless SLIC_INSTRUMENTATION is defined. */
+#include "SLICInstrumentation.h"
+
 /* Intel Threading Building Blocks libraries
 for multi-threading. */
 #include <tbb/tbb.h>
@@ -60,8 +73,124 @@ enum VideoElaborationMode {
 	ADD_SUPERPIXELS,
 	/* Add new Superpixel finding orphan pixels*/
 	ADD_SUPERPIXELS_NOISE,
+	/* Fixed camera: reuse the superpixels of the tiles which did not change
+	   with respect to a running background model. */
+	STATIC_CAMERA,
+	/* Screen capture and synthetic input: reuse the superpixels of the tiles
+	   whose content hash did not change since the previous frame. */
+	CONTENT_HASHING,
+	/* Run SLIC only on key frames; in between, warp the previous labels with
+	   a global motion estimate and correct only the superpixels' boundaries. */
+	KEY_FRAMES_PROPAGATION,
+};
+
+/* The way the superpixels of the last frame have been obtained. */
+enum SuperpixelsPath {
+	/* SLIC iterations over all the clusters. */
+	FULL_ITERATIONS,
+	/* SLIC iterations over the clusters reaching changed tiles only. */
+	FROZEN_BACKGROUND,
+	/* Labels of the previous frame warped and corrected on boundaries. */
+	LABELS_PROPAGATION,
+};
+
+/* Arithmetic used to compute distances and centres. */
+enum SLICArithmetic {
+	/* Double precision centres, distances and sums. */
+	FLOATING_POINT,
+	/* Integer centres, distances and sums, for 8-bit frames. */
+	FIXED_POINT,
+};
+
+/* Storage of the label and distance of each pixel while the clusters
+   are assigned in parallel. */
+enum PixelStateLayout {
+	/* pixelCluster, distanceFromClusterCentre and pixelReachedByClusters. */
+	SEPARATE_ARRAYS,
+	/* One 64-bit word per pixel, float distance in the high half and
+	   label in the low half, updated with a lock-free atomic minimum; it
+	   replaces distanceFromClusterCentre, so that a pixel still takes 13
+	   bytes (except with the STATIC_CAMERA and CONTENT_HASHING modes). */
+	PACKED_WORD,
+};
+
+/* Order in which the clusters are assigned their pixels. */
+enum AssignmentSchedule {
+	/* Every cluster in parallel: neighbouring clusters may write the
+	   same pixel at the same time. */
+	CLUSTER_PARALLEL,
+	/* Clusters grouped in cells of a 3 x 3 coloured grid; the cells of
+	   each colour run in parallel, one colour after the other, so that
+	   clusters running together never share a pixel. */
+	CHECKERBOARD,
+	/* Every pixel looks for the centres able to reach it and keeps the
+	   nearest one; pixels run in parallel. Other paths than the double
+	   precision iterations over all the clusters use CHECKERBOARD. */
+	PIXEL_CENTRIC,
+	/* Horizontal bands of 2 x step + 2 rows, one after the other. In
+	   each band, the clusters reaching it only assign the rows of the
+	   band, in three column classes, so the band stays in cache while
+	   all of its clusters run. Other paths than the double precision
+	   iterations over all the clusters use CHECKERBOARD. */
+	BAND_SWEEP,
+};
+
+/* Memory traffic model of the last BAND_SWEEP assignment, counting the
+   bytes of the frame and of the per-pixel buffers. It is not measured:
+   SLIC_INSTRUMENTATION builds with hardware counters read the last level
+   cache misses of the assignment phase instead. */
+struct BandSweepStatistics {
+	unsigned bandsNumber;
+	unsigned bandRows;
+	/* Bytes of one band, which should fit in the L2 cache. */
+	size_t   bandBytes;
+	/* Bytes touched when every band is read from memory once. */
+	size_t   sweepBytes;
+	/* Bytes touched when every search region is read from memory, as when
+	   clusters run in index order and evict each other's pixels. */
+	size_t   searchRegionsBytes;
+};
+
+/* Kind of change recorded in the superpixel identities log. */
+enum SuperpixelEventType {
+	/* A new superpixel identity has been created. */
+	SUPERPIXEL_BIRTH,
+	/* A superpixel identity has disappeared. */
+	SUPERPIXEL_DEATH,
+};
+
+/* The contribution of the pixels of a tile to the centre of a cluster. */
+struct TileContribution
+{
+	int    cluster;
+
+	/* Sums of the [L, A, B, x, y] values of the pixels. */
+	double sums[5];
+
+	int    pixels;
+};
+
+/* Persistent identity of a superpixel across frames. */
+typedef unsigned long long SuperpixelID;
+
+/* An entry of the superpixel identities log. */
+struct SuperpixelEvent
+{
+	SuperpixelEventType type;
+	SuperpixelID        identifier;
+
+	/* Frame in which the event happened. */
+	unsigned            frame;
+
+	/* Position of the superpixel centre when the event happened. */
+	double              x;
+	double              y;
 };
 
+/* Called after each iteration over all the clusters with the number of
+   iterations completed and the [L, A, B, x, y] centres. */
+typedef std::function<void(unsigned, const std::vector<double>&)> IterationCallback;
+
 class SLIC
 {
 protected:
@@ -145,12 +274,226 @@ protected:
 	   grid of the next frame; more information can be found in the paper). */
 	unsigned framesNumber;
 
+	/* Number of frames processed since the object was created (not
+	   reset by re-initializations). */
+	unsigned totalFramesNumber;
+
+	/* The persistent identity of each cluster. clusterIdentifiers[c] = i
+	   means that the c-th cluster is the superpixel i. Identities are kept
+	   between connected frames and matched by overlap when the grid is
+	   initialized again (key frames, ADD_SUPERPIXELS reset). */
+	std::vector<SuperpixelID> clusterIdentifiers;
+
+	/* The identity which will be given to the next new superpixel. */
+	SuperpixelID nextClusterIdentifier;
+
+	/* Labels, identities and centres of the last frame before
+	   a re-initialization, kept until the identities of the new
+	   clusters have been matched against them. */
+	std::vector<int>          previousPixelCluster;
+	std::vector<SuperpixelID> previousClusterIdentifiers;
+	std::vector<double>       previousIdentityCentres;
+
+	/* True when the clusters of the current frame still have to be
+	   matched against previousClusterIdentifiers. */
+	bool identityMatchingPending;
+
+	/* Minimum intersection over union between a new cluster and an old
+	   superpixel for the old identity to be inherited. */
+	double identityOverlapThreshold;
+
+	/* Give identities to the clusters and log their births and deaths. */
+	bool identityTracking;
+
+	/* Births and deaths of superpixel identities. */
+	std::vector<SuperpixelEvent> superpixelEvents;
+
+	/* Side of the square tiles of the static camera background model. */
+	unsigned tileSize;
+
+	/* Number of tiles along a row and along a column of the frame. */
+	unsigned tilesPerRow;
+	unsigned tilesPerColumn;
+
+	/* Minimum difference between a tile and its background model for the
+	   tile to be considered changed (sum of the absolute differences of the
+	   mean L, A, B values and of the L standard deviation). */
+	double backgroundChangeThreshold;
+
+	/* Weight of the current frame when updating the background model
+	   of an unchanged tile. */
+	double backgroundLearningRate;
+
+	/* The background model, stored as [L, A, B, L standard deviation]
+	   values for each tile, in the same way as clusterCentres. */
+	std::vector<double> backgroundModel;
+
+	/* 64-bit hash of the content of each tile in the previous frame
+	   (CONTENT_HASHING mode). */
+	std::vector<unsigned long long> tileHashes;
+
+	/* changedTiles[t] = 1 means that the t-th tile differs from its
+	   background model (or from its previous content) in the current frame. */
+	std::vector<uchar> changedTiles;
+
+	/* Cache of the contributions of each tile to the centres of the
+	   clusters owning its pixels. tileContributions[t] is only recomputed
+	   when the content or the labels of the t-th tile changed. */
+	std::vector<std::vector<TileContribution>> tileContributions;
+
+	/* tileContributionsStale[t] = 1 means that tileContributions[t] has to
+	   be recomputed. Set when a label inside the tile changes. */
+	std::vector<uchar> tileContributionsStale;
+
+	/* False when the labels changed outside the frozen path, so that no
+	   cached contribution can be trusted. */
+	bool tileContributionsValid;
+
+	/* Summed area table of changedTiles, with one extra row and column,
+	   to count the changed tiles inside a rectangle in constant time. */
+	std::vector<unsigned> changedTilesIntegral;
+
+	/* The clusters whose search region touches a changed tile. */
+	std::vector<unsigned> activeClusters;
+
+	/* clusterIsActive[c] = 1 means that the c-th cluster is in activeClusters. */
+	std::vector<uchar> clusterIsActive;
+
+	/* True when the last frame only iterated activeClusters. */
+	bool backgroundFrozen;
+
+	/* How the superpixels of the last frame have been obtained. */
+	SuperpixelsPath lastFramePath;
+
+	/* Number of boundary correction passes after warping the labels in
+	   KEY_FRAMES_PROPAGATION mode (0 only warps them). */
+	unsigned propagationRefinements;
+
+	/* Largest motion, in pixels, looked for between two frames. */
+	unsigned motionSearchRange;
+
+	/* Number of times the frame is halved before running the early
+	   iterations of a new grid (0 disables the pyramid). */
+	unsigned pyramidLevels;
+
+	/* Iterations run on the downscaled frame. */
+	unsigned pyramidCoarseIterations;
+
+	/* Full resolution iterations run after the pyramid, when the number
+	   of iterations is fixed. */
+	unsigned pyramidFinalIterations;
+
+	/* True when the current centres were initialized from the pyramid. */
+	bool centresSeededFromPyramid;
+
+	/* Centres replacing the grid at the next initialization from scratch
+	   (empty when the grid is used). */
+	std::vector<double> seedCentres;
+
+	/* True when seedCentres are those of the previous frame of a chain of
+	   connected frames, given by setPreviousFrameCentres. */
+	bool seedCentresContinueChain;
+
+	/* Observer of the iterations over all the clusters (may be empty). */
+	IterationCallback iterationCallback;
+
+#ifdef SLIC_INSTRUMENTATION
+	/* Timing of the phases of each frame and iteration. */
+	SLICInstrumentation instrumentation;
+#endif
+
+	/* Generator of the Gaussian noise added to the centres: frame n of the
+	   object draws stream n, so a seed gives the same noise on every run. */
+	BatchNormal noiseGenerator;
+
+	/* Displacements [x, y] of all the centres for the current frame. */
+	std::vector<double> noiseDisplacements;
+
+	/* Arithmetic of the iterations over all the clusters. */
+	SLICArithmetic arithmetic;
+
+	/* The color of the centres in FIXED_POINT arithmetic, stored as
+	   [L, A, B] values in Q8.8 format (1/256 units). */
+	std::vector<unsigned short> fixedCentreColors;
+
+	/* The position of the centres in FIXED_POINT arithmetic, stored as
+	   [x, y] values in 1/16 pixel units (16-bit values could not address
+	   high resolution frames). */
+	std::vector<int> fixedCentrePositions;
+
+	/* Distance of each pixel from the nearest cluster's centre in
+	   FIXED_POINT arithmetic, in 1/256 units of the double distance. */
+	std::vector<int> fixedDistanceFromClusterCentre;
+
+	/* Sums of the [L, A, B, x, y] values of the pixels of each cluster
+	   in FIXED_POINT arithmetic. */
+	std::vector<long long> fixedClusterSums;
+
+	/* spatialDistanceTable[d] = distanceFactor * d^2 for a distance d in
+	   1/16 pixel units, in the units of fixedDistanceFromClusterCentre. */
+	std::vector<int> spatialDistanceTable;
+
+	/* Per-pixel state layout of the iterations over all the clusters. */
+	PixelStateLayout pixelStateLayout;
+
+	/* Per-pixel words in PACKED_WORD layout. Non-negative floats compare
+	   like their bit patterns, so the smallest word holds the nearest
+	   cluster, ties going to the lowest index. All bits set means that no
+	   cluster reached the pixel. */
+	std::unique_ptr<std::atomic<unsigned long long>[]> packedPixelState;
+	unsigned packedPixelStateSize;
+
+	/* Order of the assignment of the clusters. */
+	AssignmentSchedule assignmentSchedule;
+
+	/* Grid index of the centres, with cells of step + 2 pixels: a
+	   centre can only reach the pixels of its cell and of the 8 around
+	   it. Rebuilt before every assignment that uses it. */
+	CentreGridIndex centresGrid;
+
+	/* Traffic model of the last BAND_SWEEP assignment. */
+	BandSweepStatistics bandSweepStatistics;
+
+	/* Clusters are renumbered along a Z-order curve every
+	   relabellingPeriod frames (0 never renumbers them). */
+	unsigned relabellingPeriod;
+
+	/* lastClusterPermutation[c] = n means that the c-th cluster before
+	   the renumbering of the last frame is now the n-th one. Empty when
+	   the last frame did not renumber the clusters. */
+	std::vector<unsigned> lastClusterPermutation;
+
+	/* Row sub-ranges each search region is split into during the
+	   assignment: 0 chooses them from the number of clusters, the step
+	   and the threads at every assignment. */
+	unsigned rowSplitting;
+
+	/* Row sub-ranges used by the last assignment. */
+	unsigned lastRowSplits;
+
+	/* Number of early iterations which evaluate only a subset of the
+	   pixels (at most 2: a quarter of them, then half of them). */
+	unsigned subsampledIterations;
+
+	/* Subsampling of the current iteration: the fraction of evaluated
+	   pixels is 1 / 2^samplingLevel. */
+	unsigned samplingLevel;
+
+	/* Moves the subsampling pattern between iterations. */
+	unsigned samplingOffset;
+
+	/* Average L value of each column and of each row of the previous
+	   frame, used to estimate the global motion. */
+	std::vector<double> previousColumnProfile;
+	std::vector<double> previousRowProfile;
+
 	/* Erase all matrices' elements and reset variables. */
 	void clearSLICData();
 
-	/* Initialize matrices' elements and variables. */
-	void initializeSLICData(
-		const cv::Mat&       image,
+	/* Initialize matrices' elements and variables. Return true when
+	   the data has been initialized from scratch. */
+	bool initializeSLICData(
+		const PlanarImage&   image,
 		const unsigned       samplingStep,
 		const unsigned       spatialDistanceWeight,
 		const double         errorThreshold,
@@ -160,11 +503,193 @@ protected:
 		/* By default we choose to process frames independently. */
 		const bool           connectedFrames = false);
 
+	/* Initialize the centres by running SLIC on a downscaled copy of the
+	   frame. Return false when the pyramid is disabled or the frame is
+	   too small for it. */
+	bool seedCentresFromPyramid(const PlanarImage& image);
+
 	/* Find the pixel with the lowest gradient in a 3x3 surrounding. */
 	cv::Point findLowestGradient(
-		const cv::Mat&   image,
+		const PlanarImage&   image,
 		const cv::Point& centre);
 
+	/* Give an identity to a cluster appended to the centres vector. */
+	void addClusterIdentity(const unsigned centreIndex);
+
+	/* Match the clusters of the current frame with the superpixels
+	   existing before the last re-initialization. */
+	void matchClusterIdentities(const PlanarImage& image);
+
+	/* Assign the pixels in the search region of a cluster to the cluster,
+	   if the cluster is the nearest found so far. Only the rows in
+	   [firstRow, endRow) are considered. */
+	void assignClusterPixels(
+		const PlanarImage&   image,
+		const unsigned       centreIndex,
+		VideoElaborationMode videoMode,
+		const int            firstRow = 0,
+		const int            endRow = INT_MAX);
+
+	/* Same as assignClusterPixels, in FIXED_POINT arithmetic. */
+	void assignClusterPixelsFixedPoint(
+		const PlanarImage&   image,
+		const unsigned       centreIndex,
+		VideoElaborationMode videoMode,
+		const int            firstRow = 0,
+		const int            endRow = INT_MAX);
+
+	/* Assign the pixels and recompute the centres in FIXED_POINT
+	   arithmetic; clusterCentres is updated from the integer centres. */
+	void updateCentresFixedPoint(
+		const PlanarImage&   image,
+		VideoElaborationMode videoMode,
+		const int            sampleWeight);
+
+	/* Same as assignClusterPixels, in PACKED_WORD layout. */
+	void assignClusterPixelsPacked(
+		const PlanarImage& image,
+		const unsigned     centreIndex,
+		const int          firstRow = 0,
+		const int          endRow = INT_MAX);
+
+	/* Assign the pixels and recompute the centres in PACKED_WORD layout;
+	   pixelCluster is updated while summing the clusters' pixels. */
+	void updateCentresPacked(
+		const PlanarImage&   image,
+		VideoElaborationMode videoMode,
+		const int            sampleWeight);
+
+	/* Number of row sub-ranges to split each of tasksNumber search
+	   regions (or cells) of windowRows rows into, so that there are
+	   enough tasks for the threads (1 when there already are). */
+	unsigned chooseRowSplits(
+		const unsigned tasksNumber,
+		const int      windowRows) const;
+
+	/* Run assignCluster(centreIndex, firstRow, endRow) on the given
+	   clusters (all of them when clusters is null) following
+	   assignmentSchedule. When there are few clusters, their search
+	   regions are split in row sub-ranges run as separate tasks. */
+	void scheduleClusterAssignment(
+		const PlanarImage&                             image,
+		const std::vector<unsigned>*                   clusters,
+		const std::function<void(unsigned, int, int)>& assignCluster);
+
+	/* Assign each pixel to the nearest centre among the ones whose
+	   search region contains it (PIXEL_CENTRIC schedule). Pixels that no
+	   centre reaches keep their label, as in the other schedules. */
+	void assignPixelsFromCentres(
+		const PlanarImage&   image,
+		VideoElaborationMode videoMode);
+
+	/* Renumber the clusters in the Z-order of their centres, so that
+	   consecutive indexes cover nearby areas, and permute every
+	   per-cluster data and the labels accordingly. */
+	void relabelClustersInMortonOrder();
+
+	/* Assign all the clusters band by band (BAND_SWEEP schedule). */
+	void assignClustersInBands(
+		const PlanarImage&   image,
+		VideoElaborationMode videoMode);
+
+	/* True when the pixel is evaluated in the current iteration. */
+	bool isPixelSampled(
+		const int x,
+		const int y);
+
+	/* Recompute the cached contributions of a tile to the cluster centres. */
+	void accumulateTileContributions(
+		const PlanarImage& image,
+		const unsigned     tileIndex);
+
+	/* Sum the cached contributions of the tiles in the search region of
+	   a cluster and store them in the cluster's centre. */
+	void sumClusterContributions(
+		const PlanarImage& image,
+		const unsigned     centreIndex);
+
+	/* Divide the sums stored in a cluster's centre by its number of pixels. */
+	void normalizeClusterCentre(const unsigned centreIndex);
+
+	/* Divide the integer sums of a cluster by its number of pixels with
+	   rounding, and store the centre in both representations. */
+	void normalizeFixedPointCentre(const unsigned centreIndex);
+
+	/* Compute the residual error of a cluster, update its previous centre
+	   and return the error. */
+	double updateResidualError(const unsigned centreIndex);
+
+	/* Finish the centres of the given clusters (all of them when clusters
+	   is null) in a single parallel pass over blocks of clusters: sum
+	   their tile contributions (when sumContributions is set), normalize
+	   them, compute their residual errors and update their previous
+	   centres. Return the sum of the residual errors, zero on the first
+	   iteration; the sum does not depend on the number of threads. */
+	double finishClusterCentres(
+		const PlanarImage&           image,
+		const std::vector<unsigned>* clusters,
+		const bool                   sumContributions);
+
+	/* Compare each tile with the background model, mark the changed ones
+	   and update the model. */
+	void detectChangedTiles(
+		const PlanarImage& image,
+		const bool         resetModel);
+
+	/* Hash the content of each tile and mark the ones whose hash differs
+	   from the previous frame. */
+	void hashChangedTiles(
+		const PlanarImage& image,
+		const bool         resetHashes);
+
+	/* Build changedTilesIntegral from changedTiles. */
+	void buildChangedTilesIntegral();
+
+	/* Tiles covered by the search region of a cluster, as
+	   [firstTileX, lastTileX) x [firstTileY, lastTileY). Return false
+	   when the search region is outside the image. */
+	bool getClusterTiles(
+		const unsigned     centreIndex,
+		const PlanarImage& image,
+		unsigned&          firstTileX,
+		unsigned&          firstTileY,
+		unsigned&          lastTileX,
+		unsigned&          lastTileY);
+
+	/* Fill activeClusters with the clusters reaching a changed tile. */
+	void selectActiveClusters(const PlanarImage& image);
+
+	/* Run SLIC iterations on all the clusters. */
+	void iterateAllClusters(
+		const PlanarImage&   image,
+		const unsigned       iterationNumber,
+		const double         errorThreshold,
+		SLICElaborationMode  SLICMode,
+		VideoElaborationMode videoMode);
+
+	/* Run SLIC iterations on the active clusters only, keeping labels and
+	   centres of the other clusters untouched. */
+	void iterateActiveClusters(
+		const PlanarImage&   image,
+		const unsigned       iterationNumber,
+		const double         errorThreshold,
+		SLICElaborationMode  SLICMode,
+		VideoElaborationMode videoMode);
+
+	/* Compute the average L value of each column and row of the frame and
+	   estimate the translation from the profiles of the previous frame. */
+	void estimateGlobalMotion(
+		const PlanarImage& image,
+		int&               motionX,
+		int&               motionY);
+
+	/* Obtain the superpixels of a frame by warping the previous labels and
+	   centres and correcting the labels of boundary pixels. */
+	void propagateSuperpixels(
+		const PlanarImage& image,
+		const int          motionX,
+		const int          motionY);
+
 	/* Compute the distance between a cluster's centre and an individual pixel. */
 	double computeDistance(
 		const int        centreIndex,
@@ -196,9 +721,26 @@ public:
 		/* By default we choose to process frames independently. */
 		const bool           connectedFrames = false);
 
+	/* Same as above, for a frame given as three planes (or any other
+	   layout PlanarImage can describe), read without copying it. */
+	void createSuperpixels(
+		const PlanarImage&   image,
+		const unsigned       samplingStep,
+		const unsigned       spatialDistanceWeight,
+		const unsigned       iterationNumber,
+		const double         errorThreshold,
+		SLICElaborationMode  SLICMode,
+		VideoElaborationMode videoMode,
+		const unsigned       keyFramesRatio,
+		const double         GaussianStdDev,
+		const bool           connectedFrames = false);
+
 	/* Enforce superpixel connectivity. */
 	void SLIC::enforceConnectivity(const cv::Mat image);
 
+	/* Same as above, for a planar frame. */
+	void enforceConnectivity(const PlanarImage& image);
+
 	/* Color each created superpixel in a certain area (by default the
 	   entire image) with superpixel's average color. */
 	void SLIC::colorSuperpixels(
@@ -217,12 +759,149 @@ public:
 		cv::Mat&          image,
 		const cv::Scalar& centreColor);
 
-	/* Draw superpixels' informations (for debug/analysis purposes). */
+	/* Update the minimum, maximum and average execution time, iterations
+	   and error with the last frame (for debug/analysis purposes). */
+	void updateStatistics(const unsigned executionTimeInMilliseconds);
+
+	/* Draw superpixels' informations (for debug/analysis purposes), as
+	   of the last call to updateStatistics. */
 	void SLIC::drawInformation(
 		cv::Mat&       image,
 		const unsigned totalFrames,
 		const unsigned executionTimeInMilliseconds);
 
+	/* The cluster of each pixel, in row-major order (-1 for pixels
+	   belonging to no cluster). */
+	const std::vector<int>& getPixelClusters() const;
+
+	/* Persistent identities of the superpixels, indexed by cluster (empty
+	   unless identity tracking is enabled). */
+	const std::vector<SuperpixelID>& getSuperpixelIdentifiers() const;
+
+	/* Births and deaths of superpixel identities since the log
+	   was last cleared. */
+	const std::vector<SuperpixelEvent>& getSuperpixelEvents() const;
+
+	/* Empty the superpixel identities log. */
+	void clearSuperpixelEvents();
+
+	/* Set the minimum overlap (intersection over union) needed to keep
+	   a superpixel identity across a re-initialization. */
+	void setIdentityOverlapThreshold(const double threshold);
+
+	/* Track the identities of the superpixels of connected frames (off by
+	   default: the matching costs a pass over the labels and a sort on
+	   every re-initialization). Turning it off forgets the identities. */
+	void setIdentityTracking(const bool enabled);
+
+	/* Set tile size, change threshold and learning rate of the background
+	   model used in STATIC_CAMERA mode (the tile size is also used by
+	   CONTENT_HASHING mode). Both modes need connected frames. */
+	void setStaticCameraParameters(
+		const unsigned tileSize,
+		const double   changeThreshold,
+		const double   learningRate);
+
+	/* Set the quality/speed trade-off of KEY_FRAMES_PROPAGATION mode:
+	   boundary correction passes and motion search range. SLIC runs
+	   every keyFramesRatio frames (only on the first one if it is 0). */
+	void setPropagationParameters(
+		const unsigned refinementPasses,
+		const unsigned searchRange);
+
+	/* How the superpixels of the last frame have been obtained. */
+	SuperpixelsPath getLastFramePath() const;
+
+	/* Choose between double precision and integer iterations. Labels
+	   only differ where two clusters are almost equally distant. */
+	void setArithmetic(const SLICArithmetic arithmetic);
+
+	/* Choose how the per-pixel state is stored during the assignment.
+	   PACKED_WORD only applies to FLOATING_POINT arithmetic. */
+	void setPixelStateLayout(const PixelStateLayout layout);
+
+	/* Choose the assignment order. CHECKERBOARD and PIXEL_CENTRIC give
+	   the same labels at every run, without atomics. */
+	void setAssignmentSchedule(const AssignmentSchedule schedule);
+
+	/* Traffic model of the last assignment of the last frame, if it swept
+	   bands (all zeros otherwise). */
+	const BandSweepStatistics& getBandSweepStatistics() const;
+
+	/* Renumber the clusters in spatial order every period frames (0
+	   disables it), after noise and added superpixels have shuffled
+	   them. Identifiers move with their clusters. */
+	void setRelabellingPeriod(const unsigned period);
+
+	/* Permutation applied to the cluster indexes by the last frame, as
+	   newIndex = permutation[oldIndex]; empty if there was none. */
+	const std::vector<unsigned>& getLastClusterPermutation() const;
+
+	/* Split the search regions in rowSplits row sub-ranges during the
+	   assignment (1 never splits them); 0, the default, splits them only
+	   when there are too few clusters for the threads. */
+	void setRowSplitting(const unsigned rowSplits);
+
+	/* Row sub-ranges used by the last assignment (1 when unsplit). */
+	unsigned getLastRowSplits() const;
+
+	/* Evaluate only a quarter, then half, of the pixels in the first
+	   iterations (0 to 2 of them). Centres are updated weighting each
+	   evaluated pixel for the skipped ones. */
+	void setSubsampledIterations(const unsigned iterations);
+
+	/* Run the early iterations of every new grid on the frame downscaled
+	   by 2^levels (0 disables it), then finish with finalIterations full
+	   resolution iterations (FIXED_ITERATIONS) or until convergence. */
+	void setPyramidParameters(
+		const unsigned levels,
+		const unsigned coarseIterations,
+		const unsigned finalIterations);
+
+	/* Initialize the clusters of the next frame from these [L, A, B, x, y]
+	   centres, e.g. those of another SLIC object, instead of the grid or
+	   the previous frame. They are used once. */
+	void setSeedCentres(const std::vector<double>& centres);
+
+	/* Continue a chain of connected frames elaborated by other SLIC
+	   objects: the next connected frame starts from these [L, A, B, x, y]
+	   centres of the previous frame, which left framesNumber and
+	   totalFramesNumber as given by getFramesNumber and
+	   getTotalFramesNumber, as if this object had elaborated it. Noise,
+	   key frames and the reset of the ADD_SUPERPIXELS modes still apply. */
+	void setPreviousFrameCentres(
+		const std::vector<double>& centres,
+		const unsigned             framesNumber,
+		const unsigned             totalFramesNumber);
+
+	/* Connected frames elaborated since the last initialization from
+	   scratch, and frames elaborated since the object was created. The
+	   frame being elaborated (e.g. from the iteration callback) is not
+	   counted yet. */
+	unsigned getFramesNumber() const;
+
+	unsigned getTotalFramesNumber() const;
+
+	/* Call callback after each iteration over all the clusters (an empty
+	   callback removes it). */
+	void setIterationCallback(const IterationCallback& callback);
+
+	/* Seed of the Gaussian noise of the NOISE modes (0 by default): the
+	   same seed gives the same noise on every run. */
+	void setNoiseSeed(const unsigned long long seed);
+
+	/* The [L, A, B, x, y] centres of the clusters. */
+	const std::vector<double>& getClusterCentres() const;
+
+#ifdef SLIC_INSTRUMENTATION
+	/* Phase timings and pixel evaluations of the frames elaborated. */
+	SLICInstrumentation& getInstrumentation();
+#endif
+
+	/* Number of clusters iterated in the last frame (all of them
+	   unless STATIC_CAMERA or CONTENT_HASHING mode froze part of the frame). */
+	unsigned getActiveClustersNumber() const;
+
 	/* The total number of cluster. */
 	unsigned clustersNumber;
 
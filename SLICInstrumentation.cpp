@@ -0,0 +1,291 @@
+/****************************************************************************/
+/*                                                                          */
+/* Filename:       SLICInstrumentation.cpp                                  */
+/*                                                                          */
+/* File base:      SLICInstrumentation                                      */
+/* File extension: cpp                                                      */
+/*                                                                          */
+/* Purpose:        per-frame and per-iteration timing of the SLIC phases    */
+/*                 with time stamp counter readings, and pixel evaluation   */
+/*                 counts; everything is compiled out unless                */
+/*                 SLIC_INSTRUMENTATION is defined                          */
+/*                                                                          */
+/****************************************************************************/
+
+#include "SLICInstrumentation.h"
+
+#ifdef SLIC_INSTRUMENTATION
+
+#include <algorithm>
+#include <thread>
+
+/* First time stamp of the program and the steady clock at the same time,
+   the reference of the tick duration. */
+static const unsigned long long                   referenceTicks = readTimestamp();
+static const std::chrono::steady_clock::time_point referenceTime = std::chrono::steady_clock::now();
+
+/* Print the instructions per cycle of each phase and the bytes it loaded
+   from memory per pixel and iteration, if any cycle was counted, for
+   framesNumber frames of pixelsNumber pixels in all. */
+static void printPhaseCounters(
+	std::ostream&            stream,
+	const unsigned long long phaseCounters[PHASES_NUMBER][PERF_COUNTERS_NUMBER],
+	const unsigned long long pixelsNumber,
+	const unsigned long long framesNumber,
+	const unsigned long long iterations)
+{
+	/* Size of a cache line, the unit of the memory transfers. */
+	const double lineBytes = 64;
+
+	bool counted = false;
+
+	for (int phase = 0; phase < PHASES_NUMBER; ++phase)
+		counted = counted || (phaseCounters[phase][PERF_CYCLES] != 0);
+
+	if (counted == false)
+		return;
+
+	stream << "Hardware counters:" << std::endl;
+
+	/* The phases outside the iterations run once per frame. */
+	for (int phase = 0; phase < PHASES_NUMBER; ++phase)
+	{
+		const unsigned long long* counters = phaseCounters[phase];
+
+		if (counters[PERF_CYCLES] == 0)
+			continue;
+
+		const bool   iterated = (phase == PHASE_ASSIGNMENT || phase == PHASE_ACCUMULATION || phase == PHASE_NORMALIZATION_RESIDUAL);
+		const double pixelIterations = (iterated && iterations != 0) ?
+			static_cast<double>(pixelsNumber) / framesNumber * iterations : static_cast<double>(pixelsNumber);
+
+		stream << "   " << SLICInstrumentation::getPhaseName(static_cast<SLICPhase>(phase))
+			<< ": IPC " << static_cast<double>(counters[PERF_INSTRUCTIONS]) / counters[PERF_CYCLES];
+
+		if (pixelIterations != 0)
+			stream << ", memory " << counters[PERF_LLC_MISSES] * lineBytes / pixelIterations << " bytes per pixel";
+
+		stream << ", branch misses " << counters[PERF_BRANCH_MISSES] << std::endl;
+	}
+}
+
+/****************************************************************************/
+/*                          SLIC Instrumentation                            */
+/****************************************************************************/
+SLICInstrumentation::SLICInstrumentation()
+{
+	this->recentFramesNumber = 64;
+	this->totals = SLICTotalsRecord();
+	this->iterationOpen = false;
+}
+
+SLICInstrumentation::SLICInstrumentation(const SLICInstrumentation& otherInstrumentation)
+{
+	this->frames = otherInstrumentation.frames;
+	this->recentFramesNumber = otherInstrumentation.recentFramesNumber;
+	this->totals = otherInstrumentation.totals;
+	this->iterationOpen = false;
+}
+
+SLICInstrumentation& SLICInstrumentation::operator=(const SLICInstrumentation& otherInstrumentation)
+{
+	this->frames = otherInstrumentation.frames;
+	this->recentFramesNumber = otherInstrumentation.recentFramesNumber;
+	this->totals = otherInstrumentation.totals;
+	this->iterationOpen = false;
+	this->pixelEvaluations.clear();
+
+	return *this;
+}
+
+void SLICInstrumentation::beginFrame(
+	const unsigned           frameIndex,
+	const unsigned long long pixelsNumber)
+{
+	/* The previous frame is complete: add it to the totals. */
+	if (frames.empty() == false)
+	{
+		const SLICFrameRecord& previousFrame = frames.back();
+
+		++totals.framesNumber;
+		totals.iterationsNumber += previousFrame.iterations.size();
+		totals.pixelsNumber += previousFrame.pixelsNumber;
+		totals.pixelEvaluations += previousFrame.pixelEvaluations;
+
+		for (int phase = 0; phase < PHASES_NUMBER; ++phase)
+		{
+			totals.phaseTicks[phase] += previousFrame.phaseTicks[phase];
+
+			for (int counter = 0; counter < PERF_COUNTERS_NUMBER; ++counter)
+				totals.phaseCounters[phase][counter] += previousFrame.phaseCounters[phase][counter];
+		}
+	}
+
+	SLICFrameRecord frame = SLICFrameRecord();
+	frame.frameIndex = frameIndex;
+	frame.pixelsNumber = pixelsNumber;
+
+	frames.push_back(frame);
+	iterationOpen = false;
+
+	while (frames.size() > recentFramesNumber)
+		frames.pop_front();
+}
+
+void SLICInstrumentation::beginIteration()
+{
+	if (frames.empty())
+		beginFrame(0, 0);
+
+	frames.back().iterations.push_back(SLICIterationRecord());
+	iterationOpen = true;
+
+	for (unsigned long long& evaluations : pixelEvaluations)
+		evaluations = 0;
+}
+
+void SLICInstrumentation::endIteration()
+{
+	if (iterationOpen == false)
+		return;
+
+	SLICIterationRecord& iteration = frames.back().iterations.back();
+
+	iteration.pixelEvaluations = pixelEvaluations.combine(
+		[](unsigned long long first, unsigned long long second) { return first + second; });
+	frames.back().pixelEvaluations += iteration.pixelEvaluations;
+
+	iterationOpen = false;
+}
+
+void SLICInstrumentation::addPhaseTicks(
+	const SLICPhase          phase,
+	const unsigned long long ticks)
+{
+	/* Connectivity is enforced after createSuperpixels, on the frame it
+	just elaborated. */
+	if (frames.empty())
+		beginFrame(0, 0);
+
+	frames.back().phaseTicks[phase] += ticks;
+
+	if (iterationOpen)
+		frames.back().iterations.back().phaseTicks[phase] += ticks;
+}
+
+void SLICInstrumentation::addPhaseCounters(
+	const SLICPhase       phase,
+	const SLICPerfSample& counters)
+{
+	if (frames.empty())
+		beginFrame(0, 0);
+
+	for (int counter = 0; counter < PERF_COUNTERS_NUMBER; ++counter)
+	{
+		frames.back().phaseCounters[phase][counter] += counters.values[counter];
+
+		if (iterationOpen)
+			frames.back().iterations.back().phaseCounters[phase][counter] += counters.values[counter];
+	}
+}
+
+void SLICInstrumentation::setRecentFramesNumber(const size_t recentFramesNumber)
+{
+	this->recentFramesNumber = std::max(recentFramesNumber, static_cast<size_t>(1));
+
+	while (frames.size() > this->recentFramesNumber)
+		frames.pop_front();
+}
+
+const std::deque<SLICFrameRecord>& SLICInstrumentation::getFrames() const
+{
+	return frames;
+}
+
+void SLICInstrumentation::clear()
+{
+	frames.clear();
+	totals = SLICTotalsRecord();
+	iterationOpen = false;
+}
+
+double SLICInstrumentation::getNanosecondsPerTick()
+{
+	/* A few milliseconds are enough for a precise ratio. */
+	while (std::chrono::steady_clock::now() - referenceTime < std::chrono::milliseconds(10))
+		std::this_thread::yield();
+
+	const unsigned long long ticks = readTimestamp();
+	const double nanoseconds = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - referenceTime).count());
+
+	return (ticks > referenceTicks) ? nanoseconds / (ticks - referenceTicks) : 1.0;
+}
+
+const char* SLICInstrumentation::getPhaseName(const SLICPhase phase)
+{
+	static const char* const names[PHASES_NUMBER] = {
+		"initialization", "assignment", "accumulation", "normalization/residual", "orphans", "connectivity" };
+
+	return names[phase];
+}
+
+void SLICInstrumentation::printLastFrame(std::ostream& stream) const
+{
+	if (frames.empty())
+		return;
+
+	const SLICFrameRecord& frame = frames.back();
+	const double           nanosecondsPerTick = getNanosecondsPerTick();
+
+	stream << "Frame " << frame.frameIndex << " (" << frame.iterations.size() << " iterations):";
+
+	for (int phase = 0; phase < PHASES_NUMBER; ++phase)
+		stream << "   " << getPhaseName(static_cast<SLICPhase>(phase)) << ": "
+			<< frame.phaseTicks[phase] * nanosecondsPerTick / 1e6 << " ms";
+
+	stream << "   pixel evaluations: " << frame.pixelEvaluations << std::endl;
+
+	printPhaseCounters(stream, frame.phaseCounters, frame.pixelsNumber, 1, frame.iterations.size());
+}
+
+void SLICInstrumentation::printSummary(std::ostream& stream) const
+{
+	if (frames.empty())
+		return;
+
+	const double nanosecondsPerTick = getNanosecondsPerTick();
+
+	/* The closed frames and the open one. */
+	const SLICFrameRecord& lastFrame = frames.back();
+
+	unsigned long long phaseTicks[PHASES_NUMBER];
+	unsigned long long phaseCounters[PHASES_NUMBER][PERF_COUNTERS_NUMBER];
+
+	for (int phase = 0; phase < PHASES_NUMBER; ++phase)
+	{
+		phaseTicks[phase] = totals.phaseTicks[phase] + lastFrame.phaseTicks[phase];
+
+		for (int counter = 0; counter < PERF_COUNTERS_NUMBER; ++counter)
+			phaseCounters[phase][counter] = totals.phaseCounters[phase][counter] + lastFrame.phaseCounters[phase][counter];
+	}
+
+	const unsigned long long framesNumber = totals.framesNumber + 1;
+	const unsigned long long iterations = totals.iterationsNumber + lastFrame.iterations.size();
+	const unsigned long long evaluations = totals.pixelEvaluations + lastFrame.pixelEvaluations;
+	const unsigned long long pixelsNumber = totals.pixelsNumber + lastFrame.pixelsNumber;
+
+	stream << "Frames: " << framesNumber
+		<< "   iterations per frame: " << static_cast<double>(iterations) / framesNumber << std::endl;
+
+	for (int phase = 0; phase < PHASES_NUMBER; ++phase)
+		stream << "   " << getPhaseName(static_cast<SLICPhase>(phase)) << ": "
+			<< phaseTicks[phase] * nanosecondsPerTick / 1e6 / framesNumber << " ms per frame" << std::endl;
+
+	stream << "   pixel evaluations per iteration: "
+		<< ((iterations != 0) ? static_cast<double>(evaluations) / iterations : 0) << std::endl;
+
+	printPhaseCounters(stream, phaseCounters, pixelsNumber, framesNumber, iterations);
+}
+
+#endif
@@ -0,0 +1,250 @@
+/****************************************************************************/
+/*                                                                          */
+/* Filename:       SLICInstrumentation.h                                    */
+/*                                                                          */
+/* File base:      SLICInstrumentation                                      */
+/* File extension: h                                                        */
+/*                                                                          */
+/* Purpose:        per-frame and per-iteration timing of the SLIC phases    */
+/*                 with time stamp counter readings, and pixel evaluation   */
+/*                 counts; everything is compiled out unless                */
+/*                 SLIC_INSTRUMENTATION is defined                          */
+/*                                                                          */
+/****************************************************************************/
+
+#ifndef SLICINSTRUMENTATION_H
+#define SLICINSTRUMENTATION_H
+
+/* Timeline of the phases, when a trace is being recorded. */
+#include "SLICTrace.h"
+
+/* Hardware counters of the phases, when they are being read. */
+#include "SLICPerfCounters.h"
+
+#ifdef SLIC_INSTRUMENTATION
+
+/* Intel Threading Building Blocks libraries. */
+#include <tbb/enumerable_thread_specific.h>
+
+#include <chrono>
+#include <deque>
+#include <ostream>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/* Phases of the elaboration of a frame. Centres normalization and
+   residual error are computed in the same pass, so they are timed
+   together. */
+enum SLICPhase
+{
+	PHASE_INITIALIZATION,
+	PHASE_ASSIGNMENT,
+	PHASE_ACCUMULATION,
+	PHASE_NORMALIZATION_RESIDUAL,
+	PHASE_ORPHANS,
+	PHASE_CONNECTIVITY,
+	PHASES_NUMBER
+};
+
+/* Time stamp counter (nanoseconds of a steady clock where there is none). */
+inline unsigned long long readTimestamp()
+{
+#if defined(_MSC_VER) || defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	return static_cast<unsigned long long>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+/* Ticks spent in each phase of one iteration, the hardware events
+   counted during each phase (zero when not counting), and the pixels
+   evaluated (distances computed) by the iteration. */
+struct SLICIterationRecord
+{
+	unsigned long long phaseTicks[PHASES_NUMBER];
+	unsigned long long phaseCounters[PHASES_NUMBER][PERF_COUNTERS_NUMBER];
+	unsigned long long pixelEvaluations;
+};
+
+/* Ticks and hardware events of each phase of one frame, iterations
+   included. */
+struct SLICFrameRecord
+{
+	unsigned                         frameIndex;
+	unsigned long long               pixelsNumber;
+	unsigned long long               phaseTicks[PHASES_NUMBER];
+	unsigned long long               phaseCounters[PHASES_NUMBER][PERF_COUNTERS_NUMBER];
+	unsigned long long               pixelEvaluations;
+	std::vector<SLICIterationRecord> iterations;
+};
+
+/* Sums over all the frames whose records are closed. */
+struct SLICTotalsRecord
+{
+	unsigned long long framesNumber;
+	unsigned long long iterationsNumber;
+	unsigned long long pixelsNumber;
+	unsigned long long phaseTicks[PHASES_NUMBER];
+	unsigned long long phaseCounters[PHASES_NUMBER][PERF_COUNTERS_NUMBER];
+	unsigned long long pixelEvaluations;
+};
+
+/****************************************************************************/
+/*                          SLIC Instrumentation                            */
+/****************************************************************************/
+class SLICInstrumentation
+{
+protected:
+
+	/* Records of the most recent frames (at most recentFramesNumber), the
+	   last one still open. */
+	std::deque<SLICFrameRecord> frames;
+	size_t                      recentFramesNumber;
+
+	/* Sums of the frames closed since the last clear, so that the memory
+	   stays bounded on long runs. */
+	SLICTotalsRecord totals;
+
+	/* True between beginIteration and endIteration. */
+	bool iterationOpen;
+
+	/* Pixel evaluations of the current iteration, counted by each thread
+	   without contention. */
+	tbb::enumerable_thread_specific<unsigned long long> pixelEvaluations;
+
+public:
+
+	/* Class constructor. */
+	SLICInstrumentation();
+
+	/* Copies keep the records, not the counts in progress. */
+	SLICInstrumentation(const SLICInstrumentation& otherInstrumentation);
+	SLICInstrumentation& operator=(const SLICInstrumentation& otherInstrumentation);
+
+	/* Open the record of a new frame of pixelsNumber pixels. */
+	void beginFrame(
+		const unsigned           frameIndex,
+		const unsigned long long pixelsNumber);
+
+	/* Open the record of a new iteration of the current frame. */
+	void beginIteration();
+
+	/* Close the current iteration, collecting the pixel evaluations. */
+	void endIteration();
+
+	/* Add ticks to a phase of the current iteration, if there is one, or
+	   of the current frame. */
+	void addPhaseTicks(
+		const SLICPhase          phase,
+		const unsigned long long ticks);
+
+	/* Add hardware events to a phase, as addPhaseTicks. */
+	void addPhaseCounters(
+		const SLICPhase       phase,
+		const SLICPerfSample& counters);
+
+	/* Count pixel evaluations of the current iteration (any thread). */
+	void countPixelEvaluations(const unsigned long long evaluations)
+	{
+		pixelEvaluations.local() += evaluations;
+	}
+
+	/* Number of frame records kept (64 by default, at least 1): the older
+	   ones only remain in the totals. */
+	void setRecentFramesNumber(const size_t recentFramesNumber);
+
+	/* Records of the most recent frames. */
+	const std::deque<SLICFrameRecord>& getFrames() const;
+
+	/* Drop all the records and the totals. */
+	void clear();
+
+	/* Nanoseconds per tick, measured against the steady clock since the
+	   first time stamp of the program. */
+	static double getNanosecondsPerTick();
+
+	/* Name of a phase. */
+	static const char* getPhaseName(const SLICPhase phase);
+
+	/* Print the phases of the last frame (or of all the frames since the
+	   last clear, averaged per frame) in milliseconds, with the pixel evaluations. When hardware
+	   events were counted, also print the instructions per cycle of each
+	   phase and the bytes it loaded from memory (last level cache misses
+	   of 64 bytes) per pixel and iteration. */
+	void printLastFrame(std::ostream& stream) const;
+	void printSummary(std::ostream& stream) const;
+};
+
+/* Adds the ticks elapsed during its lifetime to a phase, with the
+   hardware events counted meanwhile when counters are active, and records
+   them in the active trace, if any. */
+class SLICPhaseTimer
+{
+protected:
+
+	SLICInstrumentation& instrumentation;
+	const SLICPhase      phase;
+	SLICPerfCounters*    counters;
+	SLICPerfReading      startCounters;
+	unsigned long long   startTicks;
+
+public:
+
+	SLICPhaseTimer(
+		SLICInstrumentation& instrumentation,
+		const SLICPhase      phase)
+		: instrumentation(instrumentation), phase(phase)
+	{
+		this->counters = SLICPerfCounters::getActive();
+
+		if (counters != nullptr)
+			counters->read(startCounters);
+
+		this->startTicks = readTimestamp();
+	}
+
+	~SLICPhaseTimer()
+	{
+		const unsigned long long endTicks = readTimestamp();
+
+		instrumentation.addPhaseTicks(phase, endTicks - startTicks);
+
+		if (counters != nullptr)
+		{
+			SLICPerfReading endCounters;
+			counters->read(endCounters);
+
+			SLICPerfSample phaseCounters;
+			SLICPerfCounters::difference(startCounters, endCounters, phaseCounters);
+
+			instrumentation.addPhaseCounters(phase, phaseCounters);
+		}
+
+		if (SLICTraceWriter* writer = SLICTraceWriter::getActive())
+			writer->record(SLICInstrumentation::getPhaseName(phase), "phase", startTicks, endTicks, 0);
+	}
+};
+
+#define SLIC_PHASE_TIMER(instrumentation, phase)                SLICPhaseTimer phaseTimer((instrumentation), (phase))
+#define SLIC_BEGIN_FRAME(instrumentation, frameIndex, pixels)   (instrumentation).beginFrame((frameIndex), (pixels))
+#define SLIC_BEGIN_ITERATION(instrumentation)                   (instrumentation).beginIteration()
+#define SLIC_END_ITERATION(instrumentation)                     (instrumentation).endIteration()
+#define SLIC_COUNT_PIXEL_EVALUATIONS(instrumentation, count)    (instrumentation).countPixelEvaluations(count)
+
+#else
+
+#define SLIC_PHASE_TIMER(instrumentation, phase)
+#define SLIC_BEGIN_FRAME(instrumentation, frameIndex, pixels)   ((void)0)
+#define SLIC_BEGIN_ITERATION(instrumentation)                   ((void)0)
+#define SLIC_END_ITERATION(instrumentation)                     ((void)0)
+#define SLIC_COUNT_PIXEL_EVALUATIONS(instrumentation, count)    ((void)(count))
+
+#endif
+
+#endif
@@ -0,0 +1,220 @@
+/****************************************************************************/
+/*                                                                          */
+/* Filename:       SLICPerfCounters.cpp                                     */
+/*                                                                          */
+/* File base:      SLICPerfCounters                                         */
+/* File extension: cpp                                                      */
+/*                                                                          */
+/* Purpose:        hardware performance counters (cycles, instructions,     */
+/*                 last level cache misses, branch misses) of all the       */
+/*                 threads running SLIC, read through perf_event_open on    */
+/*                 Linux around each phase; compiled out unless             */
+/*                 SLIC_INSTRUMENTATION is defined                          */
+/*                                                                          */
+/****************************************************************************/
+
+#include "SLICPerfCounters.h"
+
+#ifdef SLIC_INSTRUMENTATION
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+std::atomic<SLICPerfCounters*> SLICPerfCounters::activeCounters(nullptr);
+
+/****************************************************************************/
+/*                          SLIC Perf Counters                              */
+/****************************************************************************/
+SLICPerfCounters::SLICPerfCounters()
+{
+	this->available = false;
+
+#ifdef __linux__
+	openThreadGroup();
+
+	if (available)
+	{
+		observe(true);
+		activeCounters.store(this, std::memory_order_release);
+	}
+#else
+	this->status = "hardware counters are only read on Linux";
+#endif
+}
+
+SLICPerfCounters::~SLICPerfCounters()
+{
+	SLICPerfCounters* self = this;
+	activeCounters.compare_exchange_strong(self, nullptr);
+
+	if (available)
+		observe(false);
+
+#ifdef __linux__
+	for (const ThreadGroup& group : groups)
+		for (int counter = 0; counter < PERF_COUNTERS_NUMBER; ++counter)
+			if (group.fileDescriptors[counter] != -1)
+				close(group.fileDescriptors[counter]);
+#endif
+}
+
+bool SLICPerfCounters::isAvailable() const
+{
+	return available;
+}
+
+const std::string& SLICPerfCounters::getStatus() const
+{
+	return status;
+}
+
+void SLICPerfCounters::on_scheduler_entry(bool /* isWorker */)
+{
+	bool& seen = threadSeen.local();
+
+	if (seen == false)
+	{
+		seen = true;
+		openThreadGroup();
+	}
+}
+
+void SLICPerfCounters::openThreadGroup()
+{
+#ifdef __linux__
+	static const unsigned long long configs[PERF_COUNTERS_NUMBER] = {
+		PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES };
+	static const char* const names[PERF_COUNTERS_NUMBER] = {
+		"cycles", "instructions", "LLC misses", "branch misses" };
+
+	ThreadGroup group;
+	group.valuesNumber = 0;
+
+	std::string missingEvents;
+
+	for (int counter = 0; counter < PERF_COUNTERS_NUMBER; ++counter)
+	{
+		perf_event_attr attributes;
+		memset(&attributes, 0, sizeof(attributes));
+
+		attributes.size = sizeof(attributes);
+		attributes.type = PERF_TYPE_HARDWARE;
+		attributes.config = configs[counter];
+		attributes.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		/* User space only, which perf_event_paranoid up to 2 allows. */
+		attributes.exclude_kernel = 1;
+		attributes.exclude_hv = 1;
+
+		/* The cycles lead the group, so that all the counters are
+		scheduled together. */
+		const int leader = (counter == PERF_CYCLES) ? -1 : group.fileDescriptors[PERF_CYCLES];
+
+		/* Counts the calling thread, on any CPU. */
+		group.fileDescriptors[counter] = static_cast<int>(
+			syscall(__NR_perf_event_open, &attributes, 0, -1, leader, 0));
+		group.valueIndexes[counter] = -1;
+
+		if (group.fileDescriptors[counter] == -1)
+		{
+			/* Without cycles nothing else is counted. */
+			if (counter == PERF_CYCLES)
+			{
+				std::lock_guard<std::mutex> lock(groupsMutex);
+
+				if (groups.empty())
+					status = std::string("hardware counters not available: ") + strerror(errno);
+				return;
+			}
+
+			missingEvents += std::string(missingEvents.empty() ? "" : ", ") + names[counter];
+			continue;
+		}
+
+		group.valueIndexes[counter] = group.valuesNumber++;
+	}
+
+	std::lock_guard<std::mutex> lock(groupsMutex);
+
+	if (groups.empty())
+	{
+		available = true;
+		status = missingEvents.empty() ? "" : "not counted: " + missingEvents;
+	}
+
+	groups.push_back(group);
+#endif
+}
+
+void SLICPerfCounters::read(SLICPerfReading& reading)
+{
+#ifdef __linux__
+	std::lock_guard<std::mutex> lock(groupsMutex);
+
+	reading.groups.resize(groups.size());
+
+	for (size_t n = 0; n < groups.size(); ++n)
+	{
+		const ThreadGroup&    group = groups[n];
+		SLICPerfGroupReading& groupReading = reading.groups[n];
+
+		/* Number of values, time enabled, time running, values. */
+		unsigned long long buffer[3 + PERF_COUNTERS_NUMBER];
+
+		groupReading.valid = (::read(group.fileDescriptors[PERF_CYCLES], buffer, sizeof(buffer)) >=
+			static_cast<ssize_t>((3 + group.valuesNumber) * sizeof(unsigned long long)));
+
+		if (groupReading.valid == false)
+			continue;
+
+		groupReading.timeEnabled = buffer[1];
+		groupReading.timeRunning = buffer[2];
+
+		for (int counter = 0; counter < PERF_COUNTERS_NUMBER; ++counter)
+			groupReading.values[counter] = (group.valueIndexes[counter] != -1) ? buffer[3 + group.valueIndexes[counter]] : 0;
+	}
+#else
+	reading.groups.clear();
+#endif
+}
+
+void SLICPerfCounters::difference(
+	const SLICPerfReading& start,
+	const SLICPerfReading& end,
+	SLICPerfSample&        sample)
+{
+	for (int counter = 0; counter < PERF_COUNTERS_NUMBER; ++counter)
+		sample.values[counter] = 0;
+
+	/* Groups are only ever appended, so the same index is the same thread
+	in both readings; a group opened meanwhile started from zero. */
+	static const SLICPerfGroupReading zeroReading = { true, 0, 0, {} };
+
+	for (size_t n = 0; n < end.groups.size(); ++n)
+	{
+		const SLICPerfGroupReading& startGroup = (n < start.groups.size()) ? start.groups[n] : zeroReading;
+		const SLICPerfGroupReading& endGroup = end.groups[n];
+
+		if (startGroup.valid == false || endGroup.valid == false ||
+			endGroup.timeRunning <= startGroup.timeRunning || endGroup.timeEnabled < startGroup.timeEnabled)
+			continue;
+
+		/* The kernel shares the counters among the events when there are
+		not enough of them: the differences are extrapolated to the whole
+		interval. */
+		const double scale = static_cast<double>(endGroup.timeEnabled - startGroup.timeEnabled) /
+			(endGroup.timeRunning - startGroup.timeRunning);
+
+		for (int counter = 0; counter < PERF_COUNTERS_NUMBER; ++counter)
+			if (endGroup.values[counter] >= startGroup.values[counter])
+				sample.values[counter] += static_cast<unsigned long long>(
+					(endGroup.values[counter] - startGroup.values[counter]) * scale);
+	}
+}
+
+#endif
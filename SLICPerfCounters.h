@@ -0,0 +1,138 @@
+/****************************************************************************/
+/*                                                                          */
+/* Filename:       SLICPerfCounters.h                                       */
+/*                                                                          */
+/* File base:      SLICPerfCounters                                         */
+/* File extension: h                                                        */
+/*                                                                          */
+/* Purpose:        hardware performance counters (cycles, instructions,     */
+/*                 last level cache misses, branch misses) of all the       */
+/*                 threads running SLIC, read through perf_event_open on    */
+/*                 Linux around each phase; compiled out unless             */
+/*                 SLIC_INSTRUMENTATION is defined                          */
+/*                                                                          */
+/****************************************************************************/
+
+#ifndef SLICPERFCOUNTERS_H
+#define SLICPERFCOUNTERS_H
+
+#ifdef SLIC_INSTRUMENTATION
+
+/* Intel Threading Building Blocks libraries. */
+#include <tbb/task_scheduler_observer.h>
+#include <tbb/enumerable_thread_specific.h>
+
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/* Counted hardware events. */
+enum SLICPerfCounter
+{
+	PERF_CYCLES,
+	PERF_INSTRUCTIONS,
+	PERF_LLC_MISSES,
+	PERF_BRANCH_MISSES,
+	PERF_COUNTERS_NUMBER
+};
+
+/* Values of the counters, summed over the threads. */
+struct SLICPerfSample
+{
+	unsigned long long values[PERF_COUNTERS_NUMBER];
+};
+
+/* Raw values of the counters of one thread, with the time they were
+   enabled and the time they were actually counting (less when the kernel
+   multiplexes them). */
+struct SLICPerfGroupReading
+{
+	bool               valid;
+	unsigned long long timeEnabled;
+	unsigned long long timeRunning;
+	unsigned long long values[PERF_COUNTERS_NUMBER];
+};
+
+/* Raw values of all the threads, in the order their counters were opened. */
+struct SLICPerfReading
+{
+	std::vector<SLICPerfGroupReading> groups;
+};
+
+/****************************************************************************/
+/*                          SLIC Perf Counters                              */
+/****************************************************************************/
+class SLICPerfCounters : public tbb::task_scheduler_observer
+{
+protected:
+
+	/* The counters read by the phase timers, if any. */
+	static std::atomic<SLICPerfCounters*> activeCounters;
+
+	/* One group of counters per thread: the file descriptor of each
+	   counter (-1 when the event is not supported) and the position of
+	   its value in the group. */
+	struct ThreadGroup
+	{
+		int fileDescriptors[PERF_COUNTERS_NUMBER];
+		int valueIndexes[PERF_COUNTERS_NUMBER];
+		int valuesNumber;
+	};
+
+	std::mutex               groupsMutex;
+	std::vector<ThreadGroup> groups;
+
+	/* Threads which already tried to open their group. */
+	tbb::enumerable_thread_specific<bool> threadSeen;
+
+	/* False when the counters cannot be used on this host, with the
+	   reason in status. */
+	bool        available;
+	std::string status;
+
+	/* Open the counters of the calling thread. */
+	void openThreadGroup();
+
+public:
+
+	/* Class constructor: open the counters of the calling thread and of
+	   every thread entering the TBB scheduler, and make them the active
+	   ones. When the counters are not permitted (or not on Linux) nothing
+	   is counted and isAvailable returns false. */
+	SLICPerfCounters();
+
+	/* Class destructor: stop counting and close the counters. */
+	virtual ~SLICPerfCounters();
+
+	/* The active counters (null when not counting). */
+	static SLICPerfCounters* getActive()
+	{
+		return activeCounters.load(std::memory_order_acquire);
+	}
+
+	/* True if at least the cycles are counted. */
+	bool isAvailable() const;
+
+	/* Why the counters are not available, or which events are missing. */
+	const std::string& getStatus() const;
+
+	/* Open the counters of a thread joining the scheduler. */
+	virtual void on_scheduler_entry(bool isWorker);
+
+	/* Current raw values of all the threads. */
+	void read(SLICPerfReading& reading);
+
+	/* Events counted between two readings, summed over the threads. Each
+	   thread's difference is scaled by the ratio of its enabled and running
+	   times over the interval, so multiplexed counters are extrapolated;
+	   threads not read both times count from zero or not at all. */
+	static void difference(
+		const SLICPerfReading& start,
+		const SLICPerfReading& end,
+		SLICPerfSample&        sample);
+};
+
+#endif
+
+#endif
@@ -0,0 +1,151 @@
+/****************************************************************************/
+/*                                                                          */
+/* Filename:       SLICTrace.cpp                                            */
+/*                                                                          */
+/* File base:      SLICTrace                                                */
+/* File extension: cpp                                                      */
+/*                                                                          */
+/* Purpose:        timeline of frames, iterations, phases, task ranges and  */
+/*                 pipeline stages, kept in bounded per-thread ring         */
+/*                 buffers and written as Chrome trace events (JSON, read   */
+/*                 by chrome://tracing and Perfetto); compiled out unless   */
+/*                 SLIC_INSTRUMENTATION is defined                          */
+/*                                                                          */
+/****************************************************************************/
+
+#include "SLICTrace.h"
+
+#ifdef SLIC_INSTRUMENTATION
+
+#include "SLICInstrumentation.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+std::atomic<SLICTraceWriter*> SLICTraceWriter::activeWriter(nullptr);
+
+/****************************************************************************/
+/*                           SLIC Trace Writer                              */
+/****************************************************************************/
+SLICTraceWriter::SLICTraceWriter(
+	const std::string& path,
+	const size_t       eventsPerThread)
+	: threadsNumber(0)
+{
+	this->path = path;
+	this->eventsPerThread = std::max(eventsPerThread, static_cast<size_t>(1));
+	this->originTicks = readTimestamp();
+
+	activeWriter.store(this, std::memory_order_release);
+}
+
+SLICTraceWriter::~SLICTraceWriter()
+{
+	SLICTraceWriter* self = this;
+	activeWriter.compare_exchange_strong(self, nullptr);
+
+	write();
+}
+
+void SLICTraceWriter::record(
+	const char*              name,
+	const char*              category,
+	const unsigned long long startTicks,
+	const unsigned long long endTicks,
+	const long long          argument)
+{
+	bool             exists = false;
+	SLICTraceBuffer& buffer = buffers.local(exists);
+
+	/* The buffer is allocated once, at the first event of the thread. */
+	if (exists == false)
+	{
+		buffer.events.resize(eventsPerThread);
+		buffer.recordedEvents = 0;
+		buffer.threadIndex = threadsNumber.fetch_add(1);
+	}
+
+	SLICTraceEvent& event = buffer.events[buffer.recordedEvents % eventsPerThread];
+
+	event.name = name;
+	event.category = category;
+	event.startTicks = startTicks;
+	event.durationTicks = endTicks - startTicks;
+	event.argument = argument;
+
+	++buffer.recordedEvents;
+}
+
+bool SLICTraceWriter::write() const
+{
+	std::ofstream file(path.c_str());
+
+	if (file.is_open() == false)
+		return false;
+
+	/* Chrome trace timestamps are in microseconds. */
+	const double microsecondsPerTick = SLICInstrumentation::getNanosecondsPerTick() / 1000;
+
+	unsigned long long droppedEvents = 0;
+	bool               firstEvent = true;
+
+	/* Fixed notation with nanosecond digits: the default six significant
+	digits would round the time stamps to milliseconds after a few
+	minutes. */
+	file << std::fixed << std::setprecision(3);
+
+	file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+	for (const SLICTraceBuffer& buffer : buffers)
+	{
+		const unsigned long long keptEvents = std::min<unsigned long long>(buffer.recordedEvents, eventsPerThread);
+		droppedEvents += buffer.recordedEvents - keptEvents;
+
+		file << (firstEvent ? "\n" : ",\n")
+			<< "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.threadIndex
+			<< ",\"args\":{\"name\":\"thread " << buffer.threadIndex << "\"}}";
+		firstEvent = false;
+
+		/* Oldest kept event first. */
+		for (unsigned long long n = buffer.recordedEvents - keptEvents; n < buffer.recordedEvents; ++n)
+		{
+			const SLICTraceEvent& event = buffer.events[n % eventsPerThread];
+
+			file << ",\n{\"name\":\"" << event.name
+				<< "\",\"cat\":\"" << event.category
+				<< "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer.threadIndex
+				<< ",\"ts\":" << (static_cast<long long>(event.startTicks - originTicks)) * microsecondsPerTick
+				<< ",\"dur\":" << event.durationTicks * microsecondsPerTick
+				<< ",\"args\":{\"value\":" << event.argument << "}}";
+		}
+	}
+
+	file << "\n],\"otherData\":{\"droppedEvents\":" << droppedEvents
+		<< ",\"eventsPerThread\":" << eventsPerThread << "}}\n";
+
+	return file.good();
+}
+
+/****************************************************************************/
+/*                            SLIC Trace Scope                              */
+/****************************************************************************/
+SLICTraceScope::SLICTraceScope(
+	const char*     name,
+	const char*     category,
+	const long long argument)
+{
+	this->writer = SLICTraceWriter::getActive();
+	this->name = name;
+	this->category = category;
+	this->argument = argument;
+	this->startTicks = (writer != nullptr) ? readTimestamp() : 0;
+}
+
+SLICTraceScope::~SLICTraceScope()
+{
+	if (writer != nullptr)
+		writer->record(name, category, startTicks, readTimestamp(), argument);
+}
+
+#endif
@@ -0,0 +1,138 @@
+/****************************************************************************/
+/*                                                                          */
+/* Filename:       SLICTrace.h                                              */
+/*                                                                          */
+/* File base:      SLICTrace                                                */
+/* File extension: h                                                        */
+/*                                                                          */
+/* Purpose:        timeline of frames, iterations, phases, task ranges and  */
+/*                 pipeline stages, kept in bounded per-thread ring         */
+/*                 buffers and written as Chrome trace events (JSON, read   */
+/*                 by chrome://tracing and Perfetto); compiled out unless   */
+/*                 SLIC_INSTRUMENTATION is defined                          */
+/*                                                                          */
+/****************************************************************************/
+
+#ifndef SLICTRACE_H
+#define SLICTRACE_H
+
+#ifdef SLIC_INSTRUMENTATION
+
+/* Intel Threading Building Blocks libraries. */
+#include <tbb/enumerable_thread_specific.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+/* A complete event: a named interval of one thread. Names and categories
+   are string literals, so that recording never allocates. */
+struct SLICTraceEvent
+{
+	const char*        name;
+	const char*        category;
+	unsigned long long startTicks;
+	unsigned long long durationTicks;
+	long long          argument;
+};
+
+/* The last events of one thread. */
+struct SLICTraceBuffer
+{
+	std::vector<SLICTraceEvent> events;
+
+	/* Events recorded since the start: the next one goes to
+	   recordedEvents % events.size(). */
+	unsigned long long recordedEvents;
+
+	/* Thread number in the trace. */
+	unsigned threadIndex;
+};
+
+/****************************************************************************/
+/*                           SLIC Trace Writer                              */
+/****************************************************************************/
+class SLICTraceWriter
+{
+protected:
+
+	/* The writer receiving the events, if any. */
+	static std::atomic<SLICTraceWriter*> activeWriter;
+
+	/* Destination of the trace. */
+	std::string path;
+
+	/* Capacity of the buffer of each thread: older events are
+	   overwritten, so memory stays bounded on long runs. */
+	size_t eventsPerThread;
+
+	/* Ticks of the first time stamp, the origin of the timeline. */
+	unsigned long long originTicks;
+
+	/* Numbers given to the threads in order of their first event. */
+	std::atomic<unsigned> threadsNumber;
+
+	/* One buffer per recording thread, written without locks. */
+	tbb::enumerable_thread_specific<SLICTraceBuffer> buffers;
+
+public:
+
+	/* Class constructor: the writer becomes the active one and receives
+	   the events of all the threads. */
+	SLICTraceWriter(
+		const std::string& path,
+		const size_t       eventsPerThread = 65536);
+
+	/* Class destructor: stop recording and write the trace. */
+	virtual ~SLICTraceWriter();
+
+	/* The active writer (null when no trace is being recorded). */
+	static SLICTraceWriter* getActive()
+	{
+		return activeWriter.load(std::memory_order_acquire);
+	}
+
+	/* Record an event of the calling thread. */
+	void record(
+		const char*              name,
+		const char*              category,
+		const unsigned long long startTicks,
+		const unsigned long long endTicks,
+		const long long          argument);
+
+	/* Write the events recorded so far, ordered by thread and time, in
+	   the Chrome trace event format. Only call it while no thread is
+	   recording. Return false if the file could not be written. */
+	bool write() const;
+};
+
+/* Records the interval of its lifetime, when a trace is active. */
+class SLICTraceScope
+{
+protected:
+
+	SLICTraceWriter*   writer;
+	const char*        name;
+	const char*        category;
+	long long          argument;
+	unsigned long long startTicks;
+
+public:
+
+	SLICTraceScope(
+		const char*     name,
+		const char*     category,
+		const long long argument);
+
+	~SLICTraceScope();
+};
+
+#define SLIC_TRACE_SCOPE(name, category, argument)    SLICTraceScope traceScope((name), (category), (argument))
+
+#else
+
+#define SLIC_TRACE_SCOPE(name, category, argument)
+
+#endif
+
+#endif
@@ -0,0 +1,594 @@
+/****************************************************************************/
+/*                                                                          */
+/* Filename:       TiledSLIC.cpp                                            */
+/*                                                                          */
+/* File base:      TiledSLIC                                                */
+/* File extension: cpp                                                      */
+/*                                                                          */
+/* Purpose:        SLIC superpixels of images larger than the memory,       */
+/*                 computed tile by tile on a memory-mapped raw or TIFF     */
+/*                 image and reconciled across the seams between tiles      */
+/*                                                                          */
+/****************************************************************************/
+
+#include "TiledSLIC.h"
+
+/* Memory-mapped input files. */
+#include <boost/iostreams/device/mapped_file.hpp>
+
+#include <algorithm>
+
+using namespace cv;
+
+/****************************************************************************/
+/*                               Tiled SLIC                                 */
+/****************************************************************************/
+TiledSLIC::TiledSLIC(
+	const unsigned tileSize,
+	const unsigned samplingStep,
+	const unsigned spatialDistanceWeight,
+	const unsigned iterationNumber)
+{
+	/* A tile holds at least a few superpixels along each side. */
+	this->samplingStep = std::max(samplingStep, 1u);
+	this->tileSize = std::max(tileSize, 4 * this->samplingStep);
+	this->spatialDistanceWeight = spatialDistanceWeight;
+	this->iterationNumber = iterationNumber;
+
+	/* The search window of a cluster reaches a step from its centre,
+	plus one pixel for the truncated centre coordinates and one for the
+	far side of the window: pixels farther than that from the tile cannot
+	reach a cluster whose centre is inside it. */
+	this->haloSize = this->samplingStep + 2;
+	this->seamVoteThreshold = 0.5;
+	this->nextLabel = 0;
+}
+
+void TiledSLIC::setSeamVoteThreshold(const double threshold)
+{
+	this->seamVoteThreshold = threshold;
+}
+
+unsigned TiledSLIC::tilesAlong(const unsigned length) const
+{
+	/* Tiles of about tileSize pixels, so that the last ones are not too
+	small to hold superpixels. */
+	return std::max((length + tileSize / 2) / tileSize, 1u);
+}
+
+void TiledSLIC::reconcileTileLabels(
+	const std::vector<int>& tileLabels,
+	const unsigned          tileClusters,
+	const cv::Rect&         region,
+	const cv::Rect&         core,
+	const unsigned          width,
+	std::vector<int>&       globalLabels)
+{
+	/* Votes of the seam pixels of each cluster, the pixels of the halo
+	already written by the previous tiles, for the labels written there. */
+	std::unordered_map<unsigned long long, unsigned> votes;
+	std::vector<unsigned> seamPixels(tileClusters, 0);
+	std::vector<unsigned> corePixels(tileClusters, 0);
+
+	for (int y = region.y; y < region.y + region.height; ++y)
+		for (int x = region.x; x < region.x + region.width; ++x)
+		{
+			const int tileLabel = tileLabels[(y - region.y) * region.width + x - region.x];
+
+			if (tileLabel == -1)
+				continue;
+
+			int previousLabel = -1;
+
+			if (core.contains(Point(x, y)))
+				++corePixels[tileLabel];
+			else if (y < core.y && core.y - y <= static_cast<int>(haloSize))
+				previousLabel = topSeam[(y - core.y + haloSize) * width + x];
+			else if (x < core.x && core.x - x <= static_cast<int>(haloSize) && y >= core.y && y < core.y + core.height)
+				previousLabel = leftSeam[(y - core.y) * haloSize + x - core.x + haloSize];
+
+			if (previousLabel == -1)
+				continue;
+
+			++seamPixels[tileLabel];
+			++votes[(static_cast<unsigned long long>(tileLabel) << 32) | static_cast<unsigned>(previousLabel)];
+		}
+
+	/* Greedily give each previous label to the cluster voting most for it. */
+	std::vector<std::pair<unsigned, unsigned long long>> candidates;
+	candidates.reserve(votes.size());
+
+	for (auto& vote : votes)
+		candidates.push_back(std::make_pair(vote.second, vote.first));
+
+	std::sort(candidates.begin(), candidates.end(),
+		[](const std::pair<unsigned, unsigned long long>& a, const std::pair<unsigned, unsigned long long>& b)
+		{ return a.first > b.first || (a.first == b.first && a.second < b.second); });
+
+	globalLabels.assign(tileClusters, -1);
+	std::unordered_map<int, bool> labelTaken;
+
+	for (auto& candidate : candidates)
+	{
+		const unsigned tileLabel = static_cast<unsigned>(candidate.second >> 32);
+		const int      previousLabel = static_cast<int>(candidate.second & 0xffffffff);
+
+		if (globalLabels[tileLabel] == -1 && corePixels[tileLabel] != 0 && labelTaken.count(previousLabel) == 0 &&
+			candidate.first >= seamVoteThreshold * seamPixels[tileLabel])
+		{
+			globalLabels[tileLabel] = previousLabel;
+			labelTaken[previousLabel] = true;
+		}
+	}
+
+	/* Clusters lying mostly within the seam are slivers of a superpixel of
+	the previous tiles, cut by the border of their tile: they join it even
+	if its label was already inherited. */
+	for (auto& candidate : candidates)
+	{
+		const unsigned tileLabel = static_cast<unsigned>(candidate.second >> 32);
+
+		if (globalLabels[tileLabel] == -1 && seamPixels[tileLabel] >= seamVoteThreshold * corePixels[tileLabel] &&
+			candidate.first >= seamVoteThreshold * seamPixels[tileLabel])
+			globalLabels[tileLabel] = static_cast<int>(candidate.second & 0xffffffff);
+	}
+}
+
+bool TiledSLIC::readTIFFLayout(
+	const uchar*  file,
+	const size_t  fileSize,
+	ImageLayout&  layout)
+{
+	if (fileSize < 8 || (memcmp(file, "II", 2) != 0 && memcmp(file, "MM", 2) != 0))
+		return false;
+
+	const bool bigEndian = (file[0] == 'M');
+
+	auto readInteger = [&](const size_t offset, const unsigned bytes)
+	{
+		unsigned long long value = 0;
+
+		for (unsigned byte = 0; byte < bytes; ++byte)
+			value |= static_cast<unsigned long long>(file[offset + byte]) <<
+				(8 * (bigEndian ? bytes - 1 - byte : byte));
+
+		return value;
+	};
+
+	if (readInteger(2, 2) != 42)
+		return false;
+
+	/* Only the first directory is read: it describes the full image. */
+	const size_t directory = static_cast<size_t>(readInteger(4, 4));
+
+	if (directory + 2 > fileSize || directory + 2 + 12 * readInteger(directory, 2) > fileSize)
+		return false;
+
+	/* Values of each tag, expanded from 16 or 32-bit integers, which are
+	stored within the entry when they fit in its 4 bytes. */
+	std::unordered_map<unsigned, std::vector<unsigned long long>> tags;
+
+	for (unsigned entry = 0; entry < readInteger(directory, 2); ++entry)
+	{
+		const size_t             entryOffset = directory + 2 + 12 * entry;
+		const unsigned           type = static_cast<unsigned>(readInteger(entryOffset + 2, 2));
+		const unsigned long long count = readInteger(entryOffset + 4, 4);
+
+		/* SHORT and LONG values only: the other types are not needed. */
+		if (type != 3 && type != 4)
+			continue;
+
+		const unsigned bytes = (type == 3) ? 2 : 4;
+		const size_t   values = (count * bytes <= 4) ? entryOffset + 8 :
+			static_cast<size_t>(readInteger(entryOffset + 8, 4));
+
+		if (count == 0 || values + count * bytes > fileSize)
+			return false;
+
+		std::vector<unsigned long long>& tag = tags[static_cast<unsigned>(readInteger(entryOffset, 2))];
+
+		for (unsigned long long value = 0; value < count; ++value)
+			tag.push_back(readInteger(values + value * bytes, bytes));
+	}
+
+	/* ImageWidth, ImageLength, BitsPerSample, Compression,
+	PhotometricInterpretation, StripOffsets, SamplesPerPixel, RowsPerStrip
+	and PlanarConfiguration, with their baseline defaults. */
+	auto tagValue = [&](const unsigned tag, const unsigned long long missing)
+	{
+		return (tags.count(tag) != 0) ? tags[tag][0] : missing;
+	};
+
+	if (tags.count(256) == 0 || tags.count(257) == 0 || tags.count(273) == 0 ||
+		tagValue(259, 1) != 1 || tagValue(262, 0) != 2 || tagValue(277, 1) != 3 || tagValue(284, 1) != 1)
+		return false;
+
+	/* BitsPerSample is 1 when missing. */
+	if (tags.count(258) == 0)
+		return false;
+
+	for (unsigned long long bits : tags[258])
+		if (bits != 8)
+			return false;
+
+	layout.width = static_cast<unsigned>(tagValue(256, 0));
+	layout.height = static_cast<unsigned>(tagValue(257, 0));
+	layout.pixelFormat = RAW_RGB;
+	layout.rowsPerStrip = static_cast<unsigned>(std::min(tagValue(278, layout.height), static_cast<unsigned long long>(layout.height)));
+	layout.stripOffsets = tags[273];
+
+	if (layout.width == 0 || layout.height == 0 || layout.rowsPerStrip == 0 ||
+		layout.width > fileSize / layout.height / 3 ||
+		layout.stripOffsets.size() != (layout.height + layout.rowsPerStrip - 1) / layout.rowsPerStrip)
+		return false;
+
+	/* Every strip is read where its rows are expected to be, whatever its
+	stated byte count. */
+	for (size_t strip = 0; strip < layout.stripOffsets.size(); ++strip)
+	{
+		const unsigned stripRows = std::min(layout.rowsPerStrip, layout.height - static_cast<unsigned>(strip) * layout.rowsPerStrip);
+
+		if (layout.stripOffsets[strip] + 3ULL * layout.width * stripRows > fileSize)
+			return false;
+	}
+
+	return true;
+}
+
+void TiledSLIC::readRegion(
+	const uchar*       file,
+	const ImageLayout& layout,
+	const cv::Rect&    region,
+	cv::Mat&           labRegion)
+{
+	labRegion.create(region.height, region.width, CV_8UC3);
+
+	/* Only the pages of this region are read from the file. */
+	for (int y = 0; y < region.height; ++y)
+	{
+		const unsigned imageY = region.y + y;
+
+		memcpy(labRegion.ptr<uchar>(y),
+			file + layout.stripOffsets[imageY / layout.rowsPerStrip] +
+			3ULL * ((imageY % layout.rowsPerStrip) * static_cast<size_t>(layout.width) + region.x),
+			3 * region.width);
+	}
+
+	if (layout.pixelFormat == RAW_BGR)
+		cvtColor(labRegion, labRegion, CV_BGR2Lab);
+	else if (layout.pixelFormat == RAW_RGB)
+		cvtColor(labRegion, labRegion, CV_RGB2Lab);
+}
+
+int TiledSLIC::createSuperpixels(
+	const std::string&   imagePath,
+	const unsigned       width,
+	const unsigned       height,
+	const std::string&   labelsPath,
+	const RawPixelFormat pixelFormat,
+	const size_t         headerBytes)
+{
+	boost::iostreams::mapped_file_source image;
+
+	try
+	{
+		image.open(imagePath);
+	}
+	catch (const std::exception&)
+	{
+		return -1;
+	}
+
+	if (image.size() < headerBytes + 3ULL * width * height)
+		return -1;
+
+	/* A raw image is a single strip after its header. */
+	ImageLayout layout;
+	layout.width = width;
+	layout.height = height;
+	layout.pixelFormat = pixelFormat;
+	layout.rowsPerStrip = std::max(height, 1u);
+	layout.stripOffsets.assign(1, headerBytes);
+
+	return createSuperpixels(reinterpret_cast<const uchar*>(image.data()), layout, labelsPath);
+}
+
+bool TiledSLIC::getTIFFSize(
+	const std::string& imagePath,
+	unsigned&          width,
+	unsigned&          height)
+{
+	boost::iostreams::mapped_file_source image;
+
+	try
+	{
+		image.open(imagePath);
+	}
+	catch (const std::exception&)
+	{
+		return false;
+	}
+
+	ImageLayout layout;
+
+	if (readTIFFLayout(reinterpret_cast<const uchar*>(image.data()), image.size(), layout) == false)
+		return false;
+
+	width = layout.width;
+	height = layout.height;
+
+	return true;
+}
+
+int TiledSLIC::createSuperpixelsFromTIFF(
+	const std::string& imagePath,
+	const std::string& labelsPath)
+{
+	boost::iostreams::mapped_file_source image;
+
+	try
+	{
+		image.open(imagePath);
+	}
+	catch (const std::exception&)
+	{
+		return -1;
+	}
+
+	ImageLayout layout;
+
+	if (readTIFFLayout(reinterpret_cast<const uchar*>(image.data()), image.size(), layout) == false)
+		return -1;
+
+	return createSuperpixels(reinterpret_cast<const uchar*>(image.data()), layout, labelsPath);
+}
+
+int TiledSLIC::createSuperpixels(
+	const uchar*       file,
+	const ImageLayout& layout,
+	const std::string& labelsPath)
+{
+	const unsigned width = layout.width;
+	const unsigned height = layout.height;
+
+	std::ofstream labels(labelsPath, std::ios::binary | std::ios::trunc);
+
+	if (labels.is_open() == false)
+		return -1;
+
+	nextLabel = 0;
+	topSeam.assign(haloSize * width, -1);
+	nextTopSeam.assign(haloSize * width, -1);
+
+	const unsigned tilesPerRow = tilesAlong(width);
+	const unsigned tilesPerColumn = tilesAlong(height);
+	const unsigned largestTileRows = (height + tilesPerColumn - 1) / tilesPerColumn;
+
+	for (unsigned tileRow = 0; tileRow < tilesPerColumn; ++tileRow)
+	{
+		const unsigned tileY = tileRow * height / tilesPerColumn;
+		const unsigned tileEndY = (tileRow + 1) * height / tilesPerColumn;
+
+		leftSeam.assign(haloSize * largestTileRows, -1);
+
+		for (unsigned tileColumn = 0; tileColumn < tilesPerRow; ++tileColumn)
+		{
+			const unsigned tileX = tileColumn * width / tilesPerRow;
+			const unsigned tileEndX = (tileColumn + 1) * width / tilesPerRow;
+
+			/* The tile, and the tile with its halo. The halo starts on a
+			multiple of the step, so that the tile is seeded with the grid
+			of the whole image and its clusters follow those of the whole
+			image away from the border of the halo. */
+			const Rect core(tileX, tileY, tileEndX - tileX, tileEndY - tileY);
+			const int  regionX = std::max(static_cast<int>(tileX) - static_cast<int>(haloSize), 0) /
+				samplingStep * samplingStep;
+			const int  regionY = std::max(static_cast<int>(tileY) - static_cast<int>(haloSize), 0) /
+				samplingStep * samplingStep;
+			const Rect region(regionX, regionY,
+				std::min(core.x + core.width + haloSize, width) - regionX,
+				std::min(core.y + core.height + haloSize, height) - regionY);
+
+			Mat tile;
+			readRegion(file, layout, region, tile);
+
+			/* Every tile is an independent image. */
+			SLIC tileSLIC;
+			tileSLIC.createSuperpixels(
+				tile, samplingStep, spatialDistanceWeight, iterationNumber, 0,
+				FIXED_ITERATIONS, NAIVE, 1, 0, false);
+			tileSLIC.enforceConnectivity(tile);
+
+			const std::vector<int>& tileLabels = tileSLIC.getPixelClusters();
+
+			std::vector<int> globalLabels;
+			reconcileTileLabels(tileLabels, tileSLIC.clustersNumber, region, core, width, globalLabels);
+
+			/* Clusters continuing no previous superpixel get a new label
+			when their first pixel is written. */
+			auto globalLabelAt = [&](int x, int y)
+			{
+				const int tileLabel = tileLabels[(y - region.y) * region.width + x - region.x];
+
+				if (tileLabel == -1)
+					return -1;
+
+				if (globalLabels[tileLabel] == -1)
+					globalLabels[tileLabel] = nextLabel++;
+
+				return globalLabels[tileLabel];
+			};
+
+			/* Write the labels of the tile, without its halo, keeping those
+			of its last haloSize columns and rows: the next tiles vote with
+			them. */
+			std::vector<int> row(core.width);
+
+			leftSeam.assign(haloSize * largestTileRows, -1);
+
+			for (int y = core.y; y < core.y + core.height; ++y)
+			{
+				for (int x = core.x; x < core.x + core.width; ++x)
+					row[x - core.x] = globalLabelAt(x, y);
+
+				labels.seekp(4ULL * (static_cast<size_t>(y) * width + core.x));
+				labels.write(reinterpret_cast<const char*>(row.data()), 4 * core.width);
+
+				for (int x = std::max(core.x + core.width - static_cast<int>(haloSize), core.x); x < core.x + core.width; ++x)
+					leftSeam[(y - core.y) * haloSize + x - core.x - core.width + haloSize] = row[x - core.x];
+
+				if (core.y + core.height - y <= static_cast<int>(haloSize))
+					std::copy(row.begin(), row.end(),
+						nextTopSeam.begin() + (y - core.y - core.height + haloSize) * width + core.x);
+			}
+		}
+
+		topSeam.swap(nextTopSeam);
+		nextTopSeam.assign(haloSize * width, -1);
+	}
+
+	labels.close();
+
+	return (labels.fail()) ? -1 : nextLabel;
+}
+
+bool TiledSLIC::compareWithWholeImage(
+	const std::string&   imagePath,
+	const unsigned       width,
+	const unsigned       height,
+	const std::string&   labelsPath,
+	double&              seamAgreement,
+	double&              otherAgreement,
+	const RawPixelFormat pixelFormat,
+	const size_t         headerBytes)
+{
+	boost::iostreams::mapped_file_source image;
+
+	try
+	{
+		image.open(imagePath);
+	}
+	catch (const std::exception&)
+	{
+		return false;
+	}
+
+	if (image.size() < headerBytes + 3ULL * width * height)
+		return false;
+
+	ImageLayout layout;
+	layout.width = width;
+	layout.height = height;
+	layout.pixelFormat = pixelFormat;
+	layout.rowsPerStrip = std::max(height, 1u);
+	layout.stripOffsets.assign(1, headerBytes);
+
+	return compareWithWholeImage(reinterpret_cast<const uchar*>(image.data()), layout, labelsPath,
+		seamAgreement, otherAgreement);
+}
+
+bool TiledSLIC::compareTIFFWithWholeImage(
+	const std::string& imagePath,
+	const std::string& labelsPath,
+	double&            seamAgreement,
+	double&            otherAgreement)
+{
+	boost::iostreams::mapped_file_source image;
+
+	try
+	{
+		image.open(imagePath);
+	}
+	catch (const std::exception&)
+	{
+		return false;
+	}
+
+	ImageLayout layout;
+
+	if (readTIFFLayout(reinterpret_cast<const uchar*>(image.data()), image.size(), layout) == false)
+		return false;
+
+	return compareWithWholeImage(reinterpret_cast<const uchar*>(image.data()), layout, labelsPath,
+		seamAgreement, otherAgreement);
+}
+
+bool TiledSLIC::compareWithWholeImage(
+	const uchar*       file,
+	const ImageLayout& layout,
+	const std::string& labelsPath,
+	double&            seamAgreement,
+	double&            otherAgreement)
+{
+	const unsigned width = layout.width;
+	const unsigned height = layout.height;
+
+	std::ifstream labelsFile(labelsPath, std::ios::binary);
+
+	if (labelsFile.is_open() == false)
+		return false;
+
+	Mat image;
+	std::vector<int> tiledLabels(static_cast<size_t>(width) * height);
+
+	readRegion(file, layout, Rect(0, 0, width, height), image);
+
+	labelsFile.read(reinterpret_cast<char*>(tiledLabels.data()), 4ULL * width * height);
+
+	if (labelsFile.fail())
+		return false;
+
+	/* The same parameters as every tile. */
+	SLIC wholeSLIC;
+	wholeSLIC.createSuperpixels(
+		image, samplingStep, spatialDistanceWeight, iterationNumber, 0,
+		FIXED_ITERATIONS, NAIVE, 1, 0, false);
+	wholeSLIC.enforceConnectivity(image);
+
+	const std::vector<int>& wholeLabels = wholeSLIC.getPixelClusters();
+
+	/* Columns and rows where a tile starts. */
+	std::vector<bool> seamColumns(width, false);
+	std::vector<bool> seamRows(height, false);
+
+	for (unsigned tileColumn = 1; tileColumn < tilesAlong(width); ++tileColumn)
+		seamColumns[tileColumn * width / tilesAlong(width)] = true;
+	for (unsigned tileRow = 1; tileRow < tilesAlong(height); ++tileRow)
+		seamRows[tileRow * height / tilesAlong(height)] = true;
+
+	unsigned long long seamPairs = 0, seamAgreeing = 0;
+	unsigned long long otherPairs = 0, otherAgreeing = 0;
+
+	auto comparePair = [&](const size_t first, const size_t second, const bool acrossSeam)
+	{
+		const bool agreeing =
+			(tiledLabels[first] == tiledLabels[second]) == (wholeLabels[first] == wholeLabels[second]);
+
+		if (acrossSeam)
+		{
+			++seamPairs;
+			seamAgreeing += agreeing;
+		}
+		else
+		{
+			++otherPairs;
+			otherAgreeing += agreeing;
+		}
+	};
+
+	for (unsigned y = 0; y < height; ++y)
+		for (unsigned x = 0; x < width; ++x)
+		{
+			const size_t pixel = static_cast<size_t>(y) * width + x;
+
+			if (x > 0)
+				comparePair(pixel - 1, pixel, seamColumns[x]);
+			if (y > 0)
+				comparePair(pixel - width, pixel, seamRows[y]);
+		}
+
+	seamAgreement = (seamPairs != 0) ? static_cast<double>(seamAgreeing) / seamPairs : 1;
+	otherAgreement = (otherPairs != 0) ? static_cast<double>(otherAgreeing) / otherPairs : 1;
+
+	return true;
+}
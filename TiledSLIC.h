@@ -0,0 +1,190 @@
+/****************************************************************************/
+/*                                                                          */
+/* Filename:       TiledSLIC.h                                              */
+/*                                                                          */
+/* File base:      TiledSLIC                                                */
+/* File extension: h                                                        */
+/*                                                                          */
+/* Purpose:        SLIC superpixels of images larger than the memory,       */
+/*                 computed tile by tile on a memory-mapped raw or TIFF     */
+/*                 image and reconciled across the seams between tiles      */
+/*                                                                          */
+/****************************************************************************/
+
+#ifndef TILEDSLIC_H
+#define TILEDSLIC_H
+
+#include "SLIC.h"
+
+#include <string>
+
+/* Byte order of the pixels of the raw input image. */
+enum RawPixelFormat {
+	/* Interleaved 8-bit B, G, R values, converted to Lab tile by tile. */
+	RAW_BGR,
+	/* Interleaved 8-bit L, A, B values, as produced by cv::cvtColor. */
+	RAW_LAB,
+	/* Interleaved 8-bit R, G, B values, as stored in TIFF images. */
+	RAW_RGB,
+};
+
+/****************************************************************************/
+/*                               Tiled SLIC                                 */
+/****************************************************************************/
+class TiledSLIC
+{
+protected:
+
+	/* Side of the tiles whose labels are computed at once (the tiles of
+	   the image are between 2/3 and 3/2 of it). */
+	unsigned tileSize;
+
+	/* SLIC parameters, the same for every tile. */
+	unsigned samplingStep;
+	unsigned spatialDistanceWeight;
+	unsigned iterationNumber;
+
+	/* Pixels read around each tile, so that the clusters near the border
+	   of the tile see the same neighbourhood as in the whole image. */
+	unsigned haloSize;
+
+	/* Minimum share of the seam pixels of a cluster which must carry the
+	   same label of the previous tile for the cluster to inherit it. */
+	double seamVoteThreshold;
+
+	/* Labels written by the previous tile of the row in its last haloSize
+	   columns (haloSize values per row). */
+	std::vector<int> leftSeam;
+
+	/* Labels written by the tiles of the previous row in their last
+	   haloSize rows (image width values per row). */
+	std::vector<int> topSeam;
+
+	/* Same as topSeam, filled for the next row of tiles. */
+	std::vector<int> nextTopSeam;
+
+	/* The label which will be given to the next new superpixel. */
+	int nextLabel;
+
+	/* Where the rows of the input image are in its file: a TIFF image is
+	   stored in strips of rowsPerStrip rows, a raw image in a single one. */
+	struct ImageLayout
+	{
+		unsigned                        width;
+		unsigned                        height;
+		RawPixelFormat                  pixelFormat;
+		unsigned                        rowsPerStrip;
+		std::vector<unsigned long long> stripOffsets;
+	};
+
+	/* Read the layout of a TIFF image from its header. Return false unless
+	   it is a baseline 8-bit RGB image without compression, stored in
+	   strips of interleaved samples, all of which lie within the file. */
+	static bool readTIFFLayout(
+		const uchar*  file,
+		const size_t  fileSize,
+		ImageLayout&  layout);
+
+	/* Copy a region of the image from its file and convert it to Lab. */
+	static void readRegion(
+		const uchar*       file,
+		const ImageLayout& layout,
+		const cv::Rect&    region,
+		cv::Mat&           labRegion);
+
+	/* The work of the public functions, once the file is mapped. */
+	int createSuperpixels(
+		const uchar*       file,
+		const ImageLayout& layout,
+		const std::string& labelsPath);
+
+	bool compareWithWholeImage(
+		const uchar*       file,
+		const ImageLayout& layout,
+		const std::string& labelsPath,
+		double&            seamAgreement,
+		double&            otherAgreement);
+
+	/* Number of tiles along a side of length pixels. */
+	unsigned tilesAlong(const unsigned length) const;
+
+	/* Map the clusters of a tile to global labels: a cluster inherits the
+	   label that the previous tiles wrote on most of its pixels of the
+	   halo, each label at most once, unless the cluster lies mostly within
+	   the halo. The other clusters are left to -1. */
+	void reconcileTileLabels(
+		const std::vector<int>& tileLabels,
+		const unsigned          tileClusters,
+		const cv::Rect&         region,
+		const cv::Rect&         core,
+		const unsigned          width,
+		std::vector<int>&       globalLabels);
+
+public:
+
+	/* Class constructor. */
+	TiledSLIC(
+		const unsigned tileSize,
+		const unsigned samplingStep,
+		const unsigned spatialDistanceWeight,
+		const unsigned iterationNumber);
+
+	/* Change the share of matching seam pixels needed to continue a
+	   superpixel of the previous tile (0.5 by default). */
+	void setSeamVoteThreshold(const double threshold);
+
+	/* Compute the superpixels of a width x height raw image and write
+	   their labels to labelsPath as row-major 32-bit integers. Only one
+	   tile and its halo, and haloSize rows of labels, are kept in memory:
+	   the image is mapped, so its pages are read as the tiles need them
+	   and can be dropped by the system afterwards. Return the number of
+	   superpixels, or -1 if a file cannot be used. */
+	int createSuperpixels(
+		const std::string&   imagePath,
+		const unsigned       width,
+		const unsigned       height,
+		const std::string&   labelsPath,
+		const RawPixelFormat pixelFormat = RAW_BGR,
+		const size_t         headerBytes = 0);
+
+	/* Compare the labels written by createSuperpixels with those of one
+	   SLIC run on the whole image, which must fit in the memory. Pairs of
+	   neighbouring pixels agree when they are in the same superpixel in
+	   both labellings, or in different ones in both: the closer the
+	   agreement of the pairs across the seams between tiles is to that of
+	   the other pairs, the less the seams show. Return false if a file
+	   cannot be used. */
+	bool compareWithWholeImage(
+		const std::string&   imagePath,
+		const unsigned       width,
+		const unsigned       height,
+		const std::string&   labelsPath,
+		double&              seamAgreement,
+		double&              otherAgreement,
+		const RawPixelFormat pixelFormat = RAW_BGR,
+		const size_t         headerBytes = 0);
+
+	/* Size of a TIFF image which createSuperpixelsFromTIFF can read.
+	   Return false otherwise. */
+	static bool getTIFFSize(
+		const std::string& imagePath,
+		unsigned&          width,
+		unsigned&          height);
+
+	/* Same as createSuperpixels for a TIFF image. Only baseline 8-bit RGB
+	   images without compression, stored in strips of interleaved
+	   samples, are read: other TIFF images (compressed, tiled, planar, or
+	   of another bit depth) cannot be used. */
+	int createSuperpixelsFromTIFF(
+		const std::string& imagePath,
+		const std::string& labelsPath);
+
+	/* Same as compareWithWholeImage for a TIFF image. */
+	bool compareTIFFWithWholeImage(
+		const std::string& imagePath,
+		const std::string& labelsPath,
+		double&            seamAgreement,
+		double&            otherAgreement);
+};
+
+#endif
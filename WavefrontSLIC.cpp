@@ -0,0 +1,275 @@
+/****************************************************************************/
+/*                                                                          */
+/* Filename:       WavefrontSLIC.cpp                                        */
+/*                                                                          */
+/* File base:      WavefrontSLIC                                            */
+/* File extension: cpp                                                      */
+/*                                                                          */
+/* Purpose:        SLIC superpixels of connected video frames, pipelined:   */
+/*                 each frame starts from the centres the previous frame    */
+/*                 has after a given number of iterations, so that          */
+/*                 consecutive frames overlap on different cores            */
+/*                                                                          */
+/****************************************************************************/
+
+#include "WavefrontSLIC.h"
+
+/* Boost libraries. */
+#include <boost/chrono.hpp>
+
+#include <climits>
+#include <future>
+
+using namespace cv;
+
+/****************************************************************************/
+/*                             Wavefront SLIC                               */
+/****************************************************************************/
+WavefrontSLIC::WavefrontSLIC(
+	const unsigned lagIterations,
+	const unsigned framesInFlight)
+{
+	this->lagIterations = std::max(lagIterations, 1u);
+	this->framesInFlight = std::max(framesInFlight, 2u);
+	this->strictChainComparison = false;
+}
+
+WavefrontSLIC::~WavefrontSLIC()
+{
+	for (std::thread& thread : threads)
+		if (thread.joinable())
+			thread.join();
+}
+
+bool WavefrontSLIC::supportsVideoMode(const VideoElaborationMode videoMode)
+{
+	return videoMode != STATIC_CAMERA && videoMode != CONTENT_HASHING && videoMode != KEY_FRAMES_PROPAGATION;
+}
+
+void WavefrontSLIC::setStrictChainComparison(const bool enabled)
+{
+	this->strictChainComparison = enabled;
+}
+
+double WavefrontSLIC::computeEnergy(
+	const PlanarImage& image,
+	const SLIC&        frameSLIC,
+	const unsigned     samplingStep,
+	const unsigned     spatialDistanceWeight)
+{
+	const std::vector<int>&    labels = frameSLIC.getPixelClusters();
+	const std::vector<double>& centres = frameSLIC.getClusterCentres();
+	const double distanceFactor =
+		1.0 * spatialDistanceWeight * spatialDistanceWeight / (samplingStep * samplingStep);
+
+	double   energy = 0;
+	unsigned labelledPixels = 0;
+
+	for (int y = 0; y < image.rows; ++y)
+	{
+		for (int x = 0; x < image.cols; ++x)
+		{
+			const int label = labels[y * image.cols + x];
+
+			if (label == -1)
+				continue;
+
+			const Vec3b   pixel = image.pixel(y, x);
+			const double* centre = &centres[5 * label];
+			const double  differenceL = pixel[0] - centre[0];
+			const double  differenceA = pixel[1] - centre[1];
+			const double  differenceB = pixel[2] - centre[2];
+			const double  differenceX = x - centre[3];
+			const double  differenceY = y - centre[4];
+
+			energy += differenceL * differenceL + differenceA * differenceA + differenceB * differenceB +
+				distanceFactor * (differenceX * differenceX + differenceY * differenceY);
+			++labelledPixels;
+		}
+	}
+
+	return (labelledPixels != 0) ? energy / labelledPixels : 0;
+}
+
+PlanarImage WavefrontSLIC::frameImage(const cv::Mat& frame)
+{
+	if (frame.type() != CV_8UC1)
+		return PlanarImage::fromMat(frame);
+
+	/* NV12 frame: the Y rows are two thirds of the matrix. */
+	const int frameHeight = 2 * frame.rows / 3;
+
+	return PlanarImage::fromNV12(
+		frameHeight, frame.cols, frame.ptr<uchar>(0), frame.ptr<uchar>(frameHeight),
+		frame.step, frame.step);
+}
+
+unsigned WavefrontSLIC::createSuperpixels(
+	const FrameReader&   readFrame,
+	const FrameWriter&   writeFrame,
+	const unsigned       samplingStep,
+	const unsigned       spatialDistanceWeight,
+	const unsigned       iterationNumber,
+	const double         errorThreshold,
+	SLICElaborationMode  SLICMode,
+	VideoElaborationMode videoMode,
+	const unsigned       keyFramesRatio,
+	const double         GaussianStdDev)
+{
+	if (supportsVideoMode(videoMode) == false)
+		return 0;
+
+	/* The workspaces are kept across calls, so that their buffers are
+	only allocated for the first frames. They all draw the noise of the
+	strict chain: its streams are chosen by the frame counters. Each of
+	them only sees every framesInFlight-th frame, so they do not track
+	identities. */
+	while (workspaces.size() < framesInFlight)
+		workspaces.push_back(std::unique_ptr<SLIC>(new SLIC()));
+
+	frames.resize(framesInFlight);
+	threads.resize(framesInFlight);
+	elapsedTimes.assign(framesInFlight, 0);
+
+	/* Centres published by each frame in flight after lagIterations
+	iterations (or at its end, if it stops earlier). */
+	std::vector<std::future<ChainLink>> laggedCentres(framesInFlight);
+
+	/* Clusters are added at the last iteration of these modes. */
+	const bool finalCentresOnly = (videoMode == ADD_SUPERPIXELS || videoMode == ADD_SUPERPIXELS_NOISE);
+
+	/* Write a frame once its thread has finished. */
+	auto writeFinishedFrame = [&](unsigned frameIndex)
+	{
+		const unsigned slot = frameIndex % framesInFlight;
+
+		{
+			SLIC_TRACE_SCOPE("wait frame", "pipeline", frameIndex);
+
+			threads[slot].join();
+		}
+
+		SLIC_TRACE_SCOPE("write", "pipeline", frameIndex);
+
+		if (strictChainComparison == false)
+		{
+			writeFrame(frameIndex, *workspaces[slot], frames[slot], elapsedTimes[slot], NULL);
+			return;
+		}
+
+		const PlanarImage image = frameImage(frames[slot]);
+
+		strictChain.createSuperpixels(
+			image, samplingStep, spatialDistanceWeight, iterationNumber, errorThreshold,
+			SLICMode, videoMode, keyFramesRatio, GaussianStdDev, true);
+
+		const std::vector<int>& labels = workspaces[slot]->getPixelClusters();
+		const std::vector<int>& strictChainLabels = strictChain.getPixelClusters();
+		size_t sameLabels = 0;
+
+		for (size_t n = 0; n < labels.size() && n < strictChainLabels.size(); ++n)
+			if (labels[n] == strictChainLabels[n])
+				++sameLabels;
+
+		WavefrontFrameQuality quality;
+		quality.labelsAgreement = (labels.size() != 0) ? static_cast<double>(sameLabels) / labels.size() : 1;
+		quality.energy = computeEnergy(image, *workspaces[slot], samplingStep, spatialDistanceWeight);
+		quality.strictChainEnergy = computeEnergy(image, strictChain, samplingStep, spatialDistanceWeight);
+
+		writeFrame(frameIndex, *workspaces[slot], frames[slot], elapsedTimes[slot], &quality);
+	};
+
+	unsigned framesNumber = 0;
+
+	while (true)
+	{
+		const unsigned slot = framesNumber % framesInFlight;
+
+		/* The slot is free once its last frame has been written. */
+		if (framesNumber >= framesInFlight)
+			writeFinishedFrame(framesNumber - framesInFlight);
+
+		{
+			SLIC_TRACE_SCOPE("read", "pipeline", framesNumber);
+
+			if (readFrame(frames[slot]) == false || frames[slot].data == NULL)
+				break;
+		}
+
+		/* Wait until the previous frame is far enough. */
+		ChainLink previousFrame = ChainLink();
+
+		if (framesNumber > 0)
+		{
+			SLIC_TRACE_SCOPE("wait centres", "pipeline", framesNumber);
+
+			previousFrame = laggedCentres[(framesNumber - 1) % framesInFlight].get();
+		}
+
+		std::shared_ptr<std::promise<ChainLink>> centresPromise(new std::promise<ChainLink>());
+		laggedCentres[slot] = centresPromise->get_future();
+
+		SLIC*          frameSLIC = workspaces[slot].get();
+		Mat*           frame = &frames[slot];
+		double*        elapsedTime = &elapsedTimes[slot];
+		const unsigned lag = finalCentresOnly ? UINT_MAX : lagIterations;
+		const unsigned frameIndex = framesNumber;
+
+		threads[slot] = std::thread([=]()
+		{
+			SLIC_TRACE_SCOPE("elaborate", "pipeline", frameIndex);
+
+			boost::chrono::high_resolution_clock::time_point startPoint =
+				boost::chrono::high_resolution_clock::now();
+
+			bool centresPublished = false;
+
+			/* The first frame starts the chain from scratch. */
+			if (frameIndex > 0)
+				frameSLIC->setPreviousFrameCentres(
+					previousFrame.centres, previousFrame.framesNumber, previousFrame.totalFramesNumber);
+
+			/* While the frame is elaborated, its counters do not count it yet. */
+			frameSLIC->setIterationCallback([&](unsigned iterations, const std::vector<double>& centres)
+			{
+				if (centresPublished == false && iterations >= lag)
+				{
+					ChainLink link = { centres, frameSLIC->getFramesNumber() + 1, frameSLIC->getTotalFramesNumber() + 1 };
+					centresPromise->set_value(link);
+					centresPublished = true;
+				}
+			});
+
+			/* Convert the frame from RGB to LAB color space
+			before SLIC elaboration, unless it is in NV12. */
+			if (frame->type() != CV_8UC1)
+				cvtColor(*frame, *frame, CV_BGR2Lab);
+
+			frameSLIC->createSuperpixels(
+				frameImage(*frame), samplingStep, spatialDistanceWeight, iterationNumber, errorThreshold,
+				SLICMode, videoMode, keyFramesRatio, GaussianStdDev, frameIndex > 0);
+
+			frameSLIC->setIterationCallback(IterationCallback());
+
+			if (centresPublished == false)
+			{
+				ChainLink link = { frameSLIC->getClusterCentres(), frameSLIC->getFramesNumber(), frameSLIC->getTotalFramesNumber() };
+				centresPromise->set_value(link);
+			}
+
+			boost::chrono::high_resolution_clock::time_point endPoint =
+				boost::chrono::high_resolution_clock::now();
+
+			*elapsedTime = boost::chrono::duration<double, boost::milli>(endPoint - startPoint).count();
+		});
+
+		++framesNumber;
+	}
+
+	/* Write the frames still in flight. */
+	for (unsigned frameIndex = (framesNumber >= framesInFlight) ? framesNumber - framesInFlight + 1 : 0;
+		frameIndex < framesNumber; ++frameIndex)
+		writeFinishedFrame(frameIndex);
+
+	return framesNumber;
+}
@@ -0,0 +1,141 @@
+/****************************************************************************/
+/*                                                                          */
+/* Filename:       WavefrontSLIC.h                                          */
+/*                                                                          */
+/* File base:      WavefrontSLIC                                            */
+/* File extension: h                                                        */
+/*                                                                          */
+/* Purpose:        SLIC superpixels of connected video frames, pipelined:   */
+/*                 each frame starts from the centres the previous frame    */
+/*                 has after a given number of iterations, so that          */
+/*                 consecutive frames overlap on different cores            */
+/*                                                                          */
+/****************************************************************************/
+
+#ifndef WAVEFRONTSLIC_H
+#define WAVEFRONTSLIC_H
+
+#include "SLIC.h"
+
+#include <functional>
+#include <memory>
+#include <thread>
+
+/* Comparison of a pipelined frame with the same frame elaborated by the
+   strict chain, where each frame starts from the final centres of the
+   previous one. */
+struct WavefrontFrameQuality
+{
+	/* Share of the pixels with the same label in both results. */
+	double labelsAgreement;
+
+	/* Average distance of the pixels from their cluster centre, as
+	   computed by SLIC, in the pipelined and in the strict chain result. */
+	double energy;
+	double strictChainEnergy;
+};
+
+/****************************************************************************/
+/*                             Wavefront SLIC                               */
+/****************************************************************************/
+class WavefrontSLIC
+{
+protected:
+
+	/* Iterations of a frame after which its centres seed the next frame. */
+	unsigned lagIterations;
+
+	/* Maximum number of frames being elaborated at once. */
+	unsigned framesInFlight;
+
+	/* One SLIC workspace, one frame, one thread and one elaboration time
+	   per frame in flight: the frame with index n uses the slot
+	   n % framesInFlight. */
+	std::vector<std::unique_ptr<SLIC>> workspaces;
+	std::vector<cv::Mat>               frames;
+	std::vector<std::thread>           threads;
+	std::vector<double>                elapsedTimes;
+
+	/* What a frame passes to the next one: its centres and its frame
+	   counters, see SLIC::setPreviousFrameCentres. */
+	struct ChainLink
+	{
+		std::vector<double> centres;
+		unsigned            framesNumber;
+		unsigned            totalFramesNumber;
+	};
+
+	/* Compare each frame with the strict chain. */
+	bool strictChainComparison;
+
+	/* The strict chain, a SLIC object elaborating the frames in sequence
+	   with connectedFrames = true, when comparing. */
+	SLIC strictChain;
+
+	/* Average SLIC distance of the pixels of a frame from the centres of
+	   their clusters. */
+	static double computeEnergy(
+		const PlanarImage& image,
+		const SLIC&        frameSLIC,
+		const unsigned     samplingStep,
+		const unsigned     spatialDistanceWeight);
+
+	/* View over a frame in Lab, or in NV12 if it has a single channel. */
+	static PlanarImage frameImage(const cv::Mat& frame);
+
+public:
+
+	/* Receive a frame (in BGR, as given by cv::VideoCapture, or in NV12
+	   as decoded: a single-channel matrix holding the Y rows followed by
+	   the interleaved U, V rows) and store it in the given matrix. Return
+	   false when there are no more frames. */
+	typedef std::function<bool(cv::Mat&)> FrameReader;
+
+	/* Receive the index of a frame, the SLIC workspace holding its
+	   superpixels, the frame in Lab (or in NV12, as read), its elaboration
+	   time in milliseconds and its comparison with the strict chain (null
+	   when disabled). Called in frame order, one frame at a time. */
+	typedef std::function<void(unsigned, const SLIC&, const cv::Mat&, double, const WavefrontFrameQuality*)> FrameWriter;
+
+	/* Class constructor: a frame starts after lagIterations iterations of
+	   the previous one (at least 1), with at most framesInFlight frames
+	   (at least 2) elaborated at once. */
+	WavefrontSLIC(
+		const unsigned lagIterations,
+		const unsigned framesInFlight = 2);
+
+	/* Class destructor. */
+	virtual ~WavefrontSLIC();
+
+	/* True for the video modes which only pass the centres from a frame to
+	   the next one. STATIC_CAMERA, CONTENT_HASHING and
+	   KEY_FRAMES_PROPAGATION reuse the labels of the previous frame, which
+	   only exist once it has finished, so they cannot be pipelined. */
+	static bool supportsVideoMode(const VideoElaborationMode videoMode);
+
+	/* Also elaborate each frame as the strict chain would, and report the
+	   difference (this runs the strict chain in sequence with the
+	   pipeline, so it is meant for tuning the lag only). */
+	void setStrictChainComparison(const bool enabled);
+
+	/* Elaborate all the frames given by readFrame and pass them to
+	   writeFrame in order. Frames are connected through the centres and
+	   the frame counters only, so that noise, key frames and the reset of
+	   the ADD_SUPERPIXELS modes follow the strict chain; since these modes
+	   add clusters at the last iteration, their frames pass their final
+	   centres. Return the number of frames elaborated, 0 without reading
+	   any frame if videoMode is not supported. */
+	unsigned createSuperpixels(
+		const FrameReader&   readFrame,
+		const FrameWriter&   writeFrame,
+		const unsigned       samplingStep,
+		const unsigned       spatialDistanceWeight,
+		const unsigned       iterationNumber,
+		const double         errorThreshold,
+		SLICElaborationMode  SLICMode,
+		VideoElaborationMode videoMode,
+		const unsigned       keyFramesRatio,
+		const double         GaussianStdDev);
+};
+
+#endif